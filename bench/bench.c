@@ -0,0 +1,381 @@
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <time.h>
+
+	#include "ihex.h"
+	#include "ihex_simd.h"
+	#include "ihex_mt.h"
+	#include "ihex_enc.h"
+
+	#if defined(__x86_64__) || defined(__i386__)
+		#include <x86intrin.h>
+	#endif
+
+//********************************************************************************************************
+// Configurable defines
+//********************************************************************************************************
+
+	#define DEFAULT_CORPUS_MB	64
+	#define RECORD_LEN			255
+	#define SUITE_MAX_MB		64			//	largest suite corpus unless given, up to 1024
+	#define SUITE_BYTES			(16 << 20)	//	input parsed per suite measurement, small corpora are repeated
+	#define UART_FIFO			16
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+//	Synthetic corpus shape
+	typedef struct corpus_cfg_t
+	{
+		int record_len;
+		bool crlf;
+		int ela_every;			//	data records between 04 records, 0 for contiguous data
+	} corpus_cfg_t;
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+	static const char *level_names[] = {"scalar", "sse2", "avx2", "neon"};
+
+	static const int suite_record_lens[] = {16, 32, 255};
+	static const int suite_ela_every[] = {0, 4};
+	static const size_t suite_sizes[] = {1 << 10, 64 << 10, 4 << 20, 64 << 20, 1 << 30};
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int run_suite(size_t max_size);
+	static void measure_chunked(const char *corpus, size_t size, long records, int chunk, const char *row);
+	static uint64_t parse_chunked(const char *corpus, size_t size, int chunk, bool timed);
+	static char* make_corpus(const corpus_cfg_t *cfg, size_t target_size, size_t *corpus_size, long *records);
+	static double parse_seconds(const char *corpus, size_t size);
+	static double parse_buffer_seconds(const char *corpus, size_t size);
+	static double parallel_seconds(const char *corpus, size_t size, int threads);
+	static int discard(void *user, uint32_t address, const uint8_t *data, int size);
+	static double now(void);
+	static uint64_t ticks(void);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+//	./bench [MB] [threads]	kernel and thread scaling summary
+//	./bench suite [max MB]	CSV of the corpus / chunk size matrix
+int main(int argc, char **argv)
+{
+	const corpus_cfg_t cfg = {RECORD_LEN, false, 0};
+	size_t mb = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_CORPUS_MB;
+	int threads = (argc > 2) ? atoi(argv[2]) : 1;
+	size_t size;
+	long records;
+	char *corpus;
+	double scalar_s = 0;
+	double s;
+	int level, selected;
+
+	if(argc > 1 && strcmp(argv[1], "suite") == 0)
+		return run_suite(((argc > 2) ? strtoul(argv[2], NULL, 0) : SUITE_MAX_MB) << 20);
+
+	corpus = make_corpus(&cfg, mb << 20, &size, &records);
+	if(!corpus)
+		return 1;
+
+	for(level = IHEX_SIMD_NONE; level <= IHEX_SIMD_NEON; level++)
+	{
+		selected = ihex_simd_force(level);
+		if(selected != level)
+			continue;
+
+		s = parse_seconds(corpus, size);
+		if(level == IHEX_SIMD_NONE)
+			scalar_s = s;
+		printf("%-6s %8.3f GB/s  x%.2f\n", level_names[level], size / s / 1e9, scalar_s / s);
+
+		s = parse_buffer_seconds(corpus, size);
+		printf("%-6s %8.3f GB/s  x%.2f  ihex_parse_buffer()\n", level_names[level], size / s / 1e9, scalar_s / s);
+	};
+
+	// whole-file parallel parsing with the best kernel, 1..threads
+	ihex_simd_force(-1);
+	for(level = 1; level <= threads; level++)
+	{
+		s = parallel_seconds(corpus, size, level);
+		if(level == 1)
+			scalar_s = s;
+		printf("%2d thread%s %8.3f GB/s  x%.2f  ihex_parse_parallel()\n", level, level == 1 ? " ":"s", size / s / 1e9, scalar_s / s);
+	};
+
+	free(corpus);
+	return 0;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	One CSV row per corpus shape, size and ihex_write() chunk size, using the best decode kernel.
+//	Throughput comes from a plain pass, the worst single ihex_write() call from a second pass timing each call.
+static int run_suite(size_t max_size)
+{
+	const int chunks[] = {1, UART_FIFO, 0};
+	corpus_cfg_t cfg;
+	char row[128];
+	char *corpus;
+	size_t size;
+	long records;
+	int r, e, crlf, i, c;
+
+	printf("record_len,eol,ela_every,corpus_bytes,chunk,mb_per_s,ns_per_record,max_ticks_per_call,tick\n");
+	for(r=0; r < (int)(sizeof(suite_record_lens)/sizeof(int)); r++)
+	for(e=0; e < (int)(sizeof(suite_ela_every)/sizeof(int)); e++)
+	for(crlf=0; crlf < 2; crlf++)
+	for(i=0; i < (int)(sizeof(suite_sizes)/sizeof(size_t)) && suite_sizes[i] <= max_size; i++)
+	{
+		cfg.record_len = suite_record_lens[r];
+		cfg.ela_every = suite_ela_every[e];
+		cfg.crlf = crlf;
+		corpus = make_corpus(&cfg, suite_sizes[i], &size, &records);
+		if(!corpus)
+		{
+			fprintf(stderr, "no memory for a %zu byte corpus\n", suite_sizes[i]);
+			return 1;
+		};
+
+		for(c=0; c < (int)(sizeof(chunks)/sizeof(int)); c++)
+		{
+			snprintf(row, sizeof(row), "%d,%s,%d,%zu,", cfg.record_len, crlf ? "crlf":"lf", cfg.ela_every, size);
+			if(chunks[c])
+				snprintf(&row[strlen(row)], sizeof(row) - strlen(row), "%d", chunks[c]);
+			else
+				strcat(row, "whole");
+			measure_chunked(corpus, size, records, chunks[c], row);
+		};
+		free(corpus);
+	};
+
+	return 0;
+}
+
+static void measure_chunked(const char *corpus, size_t size, long records, int chunk, const char *row)
+{
+	size_t reps = (size < SUITE_BYTES) ? SUITE_BYTES / size : 1;
+	uint64_t worst;
+	size_t rep;
+	double t;
+
+	t = now();
+	for(rep=0; rep < reps; rep++)
+		parse_chunked(corpus, size, chunk, false);
+	t = now() - t;
+
+	worst = parse_chunked(corpus, size, chunk, true);
+
+	printf("%s,%.1f,%.2f,%llu,%s\n", row, size * reps / t / 1e6, t * 1e9 / (records * reps), (unsigned long long)worst,
+	#if defined(__x86_64__) || defined(__i386__)
+		"tsc"
+	#else
+		"ns"
+	#endif
+	);
+}
+
+//	Feed the corpus to ihex_write() chunk bytes at a time (0 for all of it), as a UART driver would.
+//	Returns the longest single call in ticks() if timed.
+static uint64_t parse_chunked(const char *corpus, size_t size, int chunk, bool timed)
+{
+	ihex_ctx_t ctx;
+	uint64_t worst = 0;
+	uint64_t t = 0;
+	size_t pos = 0;
+	size_t n;
+	int r;
+
+	ihex_init(&ctx);
+	while(pos < size && !ctx.eof)
+	{
+		n = (chunk && size - pos > (size_t)chunk) ? (size_t)chunk : size - pos;
+		if(n > 0x40000000)
+			n = 0x40000000;
+
+		if(timed)
+			t = ticks();
+		r = ihex_write(&ctx, &corpus[pos], (int)n);
+		if(timed)
+		{
+			t = ticks() - t;
+			if(t > worst)
+				worst = t;
+		};
+
+		if(r < 0)
+		{
+			fprintf(stderr, "parse error %s at %zu\n", ihex_strerr(r), pos);
+			exit(1);
+		};
+		pos += r;
+		ihex_proceed(&ctx);
+	};
+
+	return worst;
+}
+
+//	Best of three passes over the corpus, whole buffer per ihex_write() call
+static double parse_seconds(const char *corpus, size_t size)
+{
+	ihex_ctx_t ctx;
+	double best = 1e9;
+	double t;
+	size_t pos;
+	int pass, r;
+
+	for(pass=0; pass < 3; pass++)
+	{
+		ihex_init(&ctx);
+		pos = 0;
+		t = now();
+		while(pos < size && !ctx.eof)
+		{
+			r = ihex_write(&ctx, &corpus[pos], (size - pos) > 0x40000000 ? 0x40000000 : (int)(size - pos));
+			if(r < 0)
+			{
+				fprintf(stderr, "parse error %s at %zu\n", ihex_strerr(r), pos);
+				exit(1);
+			};
+			pos += r;
+			ihex_proceed(&ctx);
+		};
+		t = now() - t;
+		if(t < best)
+			best = t;
+	};
+	return best;
+}
+
+//	Best of three zero copy passes in sink mode
+static double parse_buffer_seconds(const char *corpus, size_t size)
+{
+	ihex_ctx_t ctx;
+	double best = 1e9;
+	double t;
+	long r;
+	int pass;
+
+	for(pass=0; pass < 3; pass++)
+	{
+		ihex_init_sink(&ctx, discard, NULL, NULL);
+		t = now();
+		r = ihex_parse_buffer(&ctx, corpus, (long)size);
+		t = now() - t;
+		if(r < 0 || !ctx.eof)
+		{
+			fprintf(stderr, "parse error %s\n", ihex_strerr((int)r));
+			exit(1);
+		};
+		if(t < best)
+			best = t;
+	};
+	return best;
+}
+
+static double parallel_seconds(const char *corpus, size_t size, int threads)
+{
+	ihex_ctx_t ctx;
+	double best = 1e9;
+	double t;
+	int pass, r;
+
+	for(pass=0; pass < 3; pass++)
+	{
+		ihex_init_sink(&ctx, discard, NULL, NULL);
+		t = now();
+		r = ihex_parse_parallel(&ctx, corpus, (long)size, threads);
+		t = now() - t;
+		if(r != IHEX_OK || !ctx.eof)
+		{
+			fprintf(stderr, "parse error %s\n", ihex_strerr(r));
+			exit(1);
+		};
+		if(t < best)
+			best = t;
+	};
+	return best;
+}
+
+static int discard(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	(void)user;
+	(void)address;
+	(void)data;
+	(void)size;
+	return IHEX_OK;
+}
+
+//	Random data encoded with ihex_enc_t, records_len bytes per record.
+//	With ela_every set the data jumps to the next 64K segment after that many records, forcing an 04 record.
+//	records is set to the number of lines.
+static char* make_corpus(const corpus_cfg_t *cfg, size_t target_size, size_t *corpus_size, long *records)
+{
+	uint8_t data[255];
+	char *corpus = malloc(target_size + 2*IHEX_ENC_LINE_MAX);
+	ihex_enc_t enc;
+	uint32_t address = 0;
+	size_t pos = 0;
+	long count = 0;
+	size_t n;
+	int i;
+
+	if(!corpus)
+		return NULL;
+
+	ihex_enc_init(&enc, &corpus[pos], 2*IHEX_ENC_LINE_MAX, cfg->record_len);
+	enc.crlf = cfg->crlf;
+	while(pos < target_size)
+	{
+		for(i=0; i < cfg->record_len; i++)
+			data[i] = (uint8_t)rand();
+		ihex_enc_write(&enc, address, data, cfg->record_len);
+		address += cfg->record_len;
+		if(cfg->ela_every && (++count % cfg->ela_every) == 0)
+			address = (address + 0x10000) & 0xFFFF0000;
+
+		// the encoder writes straight into the corpus, move its window along
+		pos += enc.out_len;
+		enc.out = &corpus[pos];
+		ihex_enc_proceed(&enc);
+	};
+	ihex_enc_eof(&enc);
+	pos += enc.out_len;
+
+	count = 0;
+	for(n=0; n < pos; n++)
+		count += (corpus[n] == '\n');
+
+	*corpus_size = pos;
+	*records = count;
+	return corpus;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
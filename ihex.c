@@ -1,9 +1,14 @@
 
 
 	#include <stdint.h>
+	#include <stddef.h>
 	#include <string.h>
+	#include <limits.h>
 
 	#include "ihex.h"
+	#ifdef IHEX_SIMD
+		#include "ihex_simd.h"
+	#endif
 
 //********************************************************************************************************
 // Local defines
@@ -11,6 +16,49 @@
 
 	#define MIN_VALID_LINE_LEN			((int)sizeof(":LLAAAATTCC")-1)
 	#define MIN_VALID_BYTE_COUNT		((MIN_VALID_LINE_LEN-1)/2)
+	#define MAX_VALID_LINE_LEN			((int)sizeof(":LLAAAATT")-1 + 2*255 + 2)
+
+//	Alignment of ihex_ctx_t, for contexts laid out back to back by ihex_ctx_size()
+	#define CTX_ALIGN					offsetof(struct { char c; ihex_ctx_t ctx; }, ctx)
+
+//	ihex_checkpoint() blob, little endian:
+//	 version, flags, ext_lin_addr, input offset, line_count, line_offset, skip_lines (4 bytes each),
+//	 text_size (2), line_flags, checksum, partial line (text, or the bytes decoded so far), Fletcher-16 of the above
+	#define CKPT_HEADER_LEN				26
+	#define CKPT_EOF					0x01
+	#define CKPT_DECODED				0x02	//	partial line saved by an IHEX_STREAM_DECODE build
+	#define CKPT_FRAGMENTS				0x04	//	partial line saved by an IHEX_FRAGMENT_SIZE build
+#if defined(IHEX_FRAGMENT_SIZE)
+	#define CKPT_FORM					(CKPT_DECODED | CKPT_FRAGMENTS)
+	#define CKPT_PARTIAL(text_size)		((text_size) ? 4 + IHEX_FRAGMENT_SIZE + 1 : 0)
+#elif defined(IHEX_STREAM_DECODE)
+	#define CKPT_FORM					CKPT_DECODED
+	#define CKPT_PARTIAL(text_size)		((text_size)/2)
+#else
+	#define CKPT_FORM					0
+	#define CKPT_PARTIAL(text_size)		(text_size)
+#endif
+
+//	Record header (LL AAAA TT) and payload of the decoded line, IHEX_FRAGMENT_SIZE builds keep them apart
+#ifdef IHEX_FRAGMENT_SIZE
+	#define REC_HEADER(ctx)				((ctx)->rec_header)
+	#define REC_PAYLOAD(ctx)			((ctx)->data_buffer)
+#else
+	#define REC_HEADER(ctx)				((ctx)->data_buffer)
+	#define REC_PAYLOAD(ctx)			(&(ctx)->data_buffer[4])
+#endif
+
+//	IHEX_STREAM_DECODE line_flags, problems seen mid-line are reported at LF in the same order as process_line()
+	#define LINE_BAD_START				0x01
+	#define LINE_BAD_HEX				0x02
+	#define LINE_HELD					0x04	//	IHEX_FRAGMENT_SIZE, data_buffer holds the last fragment to surface
+
+//	Data records are handed over by deliver_data() (or only noted in the manifest) rather than held for ihex_proceed()
+#ifdef IHEX_SLOTS
+	#define HANDS_OVER(ctx)				((ctx)->on_data != NULL || (ctx)->manifest != NULL || (ctx)->slotted)
+#else
+	#define HANDS_OVER(ctx)				((ctx)->on_data != NULL || (ctx)->manifest != NULL)
+#endif
 
 
 //********************************************************************************************************
@@ -21,20 +69,71 @@
 // Private variables
 //********************************************************************************************************
 
+#if IHEX_DECODE_KERNEL == IHEX_DECODE_LUT
+//	Hex digit value, or 0xFF for any other character
+	static const uint8_t nibble_lut[256] =
+	{
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF
+	};
+#endif
+
 //********************************************************************************************************
 // Private prototypes
 //********************************************************************************************************
 
 	static int write_chunk(ihex_ctx_t *ctx, const char *src, int src_len);
 
-	static int ascii2raw(uint8_t *dst, const char *src, int byte_count);
+#ifdef IHEX_STREAM_DECODE
+	static void decode_char(ihex_ctx_t *ctx, char c);
+#else
+	static int ascii2raw(uint8_t *dst, const char *src, int byte_count, uint8_t *checksum);
+	#if IHEX_DECODE_KERNEL == IHEX_DECODE_SWAR
+		static uint32_t swar_decode(uint32_t w, uint32_t *bad);
+	#endif
+#endif
 	static int8_t hex_nibble(uint8_t c);
 
 	static int process_line(ihex_ctx_t *ctx);
+	static int end_line(ihex_ctx_t *ctx);
+	static void next_line(ihex_ctx_t *ctx);
+	static void skip_line(ihex_ctx_t *ctx);
+	static void clear_line(ihex_ctx_t *ctx);
+#ifndef IHEX_STREAM_DECODE
+	static int process_text(ihex_ctx_t *ctx, const char *text, int text_size);
+	static long parse_lines(ihex_ctx_t *ctx, const char *src, long src_len);
+#endif
+	static int process_record(ihex_ctx_t *ctx, int byte_count, uint8_t checksum);
 	static int process_rec_data(ihex_ctx_t *ctx);
+	static int surface_data(ihex_ctx_t *ctx, uint32_t address, int size, bool last);
+	static void note_record(ihex_manifest_t *m, uint32_t address, int size);
+	static int surface_piece(ihex_ctx_t *ctx);
+	static bool clip_to_windows(const ihex_ctx_t *ctx, uint32_t *address, int *size);
+	static int windowed_end(const ihex_ctx_t *ctx, uint32_t address, int size);
 	static int process_rec_eof(ihex_ctx_t *ctx);
 	static int process_rec_ext_lin_add(ihex_ctx_t *ctx);
 
+	static bool accepting(ihex_ctx_t *ctx);
+	static int deliver_data(ihex_ctx_t *ctx);
+
+	static void put_u32(uint8_t *dst, uint32_t v);
+	static uint32_t get_u32(const uint8_t *src);
+	static uint16_t fletcher16(const uint8_t *src, int len);
+
 //********************************************************************************************************
 // Public functions
 //********************************************************************************************************
@@ -42,22 +141,147 @@
 void ihex_init(ihex_ctx_t *ctx)
 {
 	memset(ctx, 0, sizeof(*ctx));
+	ctx->line_max = IHEX_TEXT_LEN_MAX;
 }
 
+size_t ihex_ctx_size(int max_line)
+{
+	size_t size;
+
+	if(max_line < MIN_VALID_LINE_LEN)
+		max_line = MIN_VALID_LINE_LEN;
+	if(max_line > MAX_VALID_LINE_LEN)
+		max_line = MAX_VALID_LINE_LEN;
+
+#if defined(IHEX_FRAGMENT_SIZE)
+	size = sizeof(ihex_ctx_t);
+#elif defined(IHEX_STREAM_DECODE)
+	size = offsetof(ihex_ctx_t, data_buffer) + (max_line-1)/2;
+#else
+	size = offsetof(ihex_ctx_t, text_buffer) + max_line;
+#endif
+
+	return (size + CTX_ALIGN-1) / CTX_ALIGN * CTX_ALIGN;
+}
+
+ihex_ctx_t* ihex_init_ex(void *mem, size_t size)
+{
+	ihex_ctx_t *ctx = NULL;
+	long line_max;
+
+	// the longest line the buffer at the end of the context takes
+#if defined(IHEX_FRAGMENT_SIZE)
+	line_max = (size >= sizeof(ihex_ctx_t)) ? MAX_VALID_LINE_LEN:0;
+#elif defined(IHEX_STREAM_DECODE)
+	line_max = (size > offsetof(ihex_ctx_t, data_buffer)) ? 2*(long)(size - offsetof(ihex_ctx_t, data_buffer)) + 2 : 0;
+#else
+	line_max = (size > offsetof(ihex_ctx_t, text_buffer)) ? (long)(size - offsetof(ihex_ctx_t, text_buffer)) : 0;
+#endif
+
+	if(mem && line_max >= MIN_VALID_LINE_LEN)
+	{
+		ctx = mem;
+		memset(ctx, 0, size);
+		ctx->line_max = (line_max > MAX_VALID_LINE_LEN) ? MAX_VALID_LINE_LEN:(int)line_max;
+	};
+
+	return ctx;
+}
+
+void ihex_init_scan(ihex_ctx_t *ctx, ihex_manifest_t *manifest)
+{
+	ihex_init(ctx);
+	ihex_set_scan(ctx, manifest);
+}
+
+void ihex_set_scan(ihex_ctx_t *ctx, ihex_manifest_t *manifest)
+{
+	ctx->manifest = manifest;
+}
+
+void ihex_manifest_init(ihex_manifest_t *manifest, uint32_t *pages, uint32_t page_base, uint32_t page_size, uint32_t page_count)
+{
+	memset(manifest, 0, sizeof(*manifest));
+	manifest->pages = pages;
+	manifest->page_base = page_base;
+	manifest->page_size = page_size;
+	manifest->page_count = page_count;
+	if(pages)
+		memset(pages, 0, ((page_count + 31) / 32) * sizeof(uint32_t));
+}
+
+void ihex_set_windows(ihex_ctx_t *ctx, const ihex_window_t *windows, int count)
+{
+	ctx->windows = windows;
+	ctx->window_count = count;
+}
+
+void ihex_init_sink(ihex_ctx_t *ctx, ihex_data_fn on_data, ihex_eof_fn on_eof, void *user)
+{
+	ihex_init(ctx);
+	ihex_set_sink(ctx, on_data, on_eof, user);
+}
+
+void ihex_set_sink(ihex_ctx_t *ctx, ihex_data_fn on_data, ihex_eof_fn on_eof, void *user)
+{
+	ctx->on_data = on_data;
+	ctx->on_eof = on_eof;
+	ctx->user = user;
+}
 
 int ihex_write(ihex_ctx_t *ctx, const char *src, int src_len)
 {
 	int retval;
-	if(ctx->err != IHEX_OK)
-		retval = ctx->err;
-	else if(ctx->eof == false && ctx->data_size == 0)
+
+	if(accepting(ctx))
 		retval = write_chunk(ctx, src, src_len);
 	else
-		retval = 0;
+		retval = ctx->err ? ctx->err:0;
 
 	return retval;
 }
 
+int ihex_writev(ihex_ctx_t *ctx, const ihex_iovec_t *iov, int iovcnt)
+{
+	bool more = true;
+	int accepted = 0;
+	int r, i;
+
+	// the line in progress carries over from one span to the next
+	for(i=0; i < iovcnt && more; i++)
+	{
+		r = ihex_write(ctx, iov[i].base, iov[i].len);
+		if(r > 0)
+			accepted += r;
+		more = (r == iov[i].len);
+	};
+
+	return ctx->err ? ctx->err:accepted;
+}
+
+long ihex_parse_buffer(ihex_ctx_t *ctx, const char *src, long src_len)
+{
+	long accepted = 0;
+	int r;
+
+	while(accepted < src_len && accepting(ctx))
+	{
+#ifndef IHEX_STREAM_DECODE
+		if(ctx->text_size == 0)
+			accepted += parse_lines(ctx, &src[accepted], src_len - accepted);
+		else
+#endif
+		{
+			// finish a line started by an earlier call (or decode char by char in IHEX_STREAM_DECODE builds)
+			r = write_chunk(ctx, &src[accepted], (src_len - accepted) > INT_MAX ? INT_MAX:(int)(src_len - accepted));
+			if(r > 0)
+				accepted += r;
+		};
+	};
+
+	return ctx->err ? ctx->err:accepted;
+}
+
 const char* ihex_strerr(int err)
 {
 	const char *c;
@@ -71,6 +295,9 @@ const char* ihex_strerr(int err)
 		case IHEX_ERR_EXT_ADDR:				c = "EXT_ADDR"; break;
 		case IHEX_ERR_EOF:					c = "EOF"; break;
 		case IHEX_ERR_START:				c = "START"; break;
+		case IHEX_ERR_IO:					c = "IO"; break;
+		case IHEX_ERR_OVERLAP:				c = "OVERLAP"; break;
+		case IHEX_ERR_FULL:					c = "FULL"; break;
 		default : c = "";
 	};
 	return c;
@@ -79,17 +306,172 @@ const char* ihex_strerr(int err)
 void ihex_proceed(ihex_ctx_t *ctx)
 {
 	ctx->data_size = 0;
+	// the next piece of a record that overlaps several windows, if any
+	surface_piece(ctx);
+}
+
+void ihex_retry(ihex_ctx_t *ctx, uint32_t resend_line)
+{
+	// the failing line, and a record it left pending in a refusing sink, are dropped and will be parsed again
+	ctx->err = IHEX_OK;
+	ctx->data_size = 0;
+	ctx->clip_size = 0;
+	ctx->line_chars = 0;
+	clear_line(ctx);
+	ctx->skip_lines = (resend_line < ctx->line_count) ? ctx->line_count - resend_line : 0;
+}
+
+#ifdef IHEX_SLOTS
+
+void ihex_init_slots(ihex_ctx_t *ctx)
+{
+	ihex_init(ctx);
+	ctx->slotted = true;
+}
+
+ihex_slot_t* ihex_slot_front(ihex_ctx_t *ctx)
+{
+	return ctx->slot_count ? &ctx->slots[ctx->slot_head]:NULL;
+}
+
+void ihex_slot_release(ihex_ctx_t *ctx)
+{
+	if(ctx->slot_count)
+	{
+		ctx->slot_head = (ctx->slot_head + 1) % IHEX_SLOTS;
+		ctx->slot_count--;
+	};
+}
+
+#endif
+
+uint32_t ihex_input_offset(const ihex_ctx_t *ctx)
+{
+	return ctx->line_offset + ctx->line_chars;
+}
+
+int ihex_checkpoint(const ihex_ctx_t *ctx, uint8_t *dst, int dst_size)
+{
+	int retval;
+	int partial = CKPT_PARTIAL(ctx->text_size);
+	uint16_t check;
+
+	if(ctx->err)
+		retval = ctx->err;
+	else if(ctx->data_size)
+		retval = IHEX_SINK_BUSY;
+	else if(dst_size < CKPT_HEADER_LEN + partial + 2)
+		retval = IHEX_ERR_LEN;
+	else
+	{
+		dst[0] = IHEX_CHECKPOINT_VERSION;
+		dst[1] = (ctx->eof ? CKPT_EOF:0) | CKPT_FORM;
+		put_u32(&dst[2], ctx->ext_lin_addr);
+		put_u32(&dst[6], ihex_input_offset(ctx));
+		put_u32(&dst[10], ctx->line_count);
+		put_u32(&dst[14], ctx->line_offset);
+		put_u32(&dst[18], ctx->skip_lines);
+		dst[22] = ctx->text_size & 0xFF;
+		dst[23] = ctx->text_size >> 8;
+	#if defined(IHEX_FRAGMENT_SIZE)
+		dst[24] = ctx->line_flags;
+		dst[25] = ctx->checksum;
+		if(partial)
+		{
+			memcpy(&dst[CKPT_HEADER_LEN], ctx->rec_header, 4);
+			memcpy(&dst[CKPT_HEADER_LEN + 4], ctx->data_buffer, IHEX_FRAGMENT_SIZE);
+			dst[CKPT_HEADER_LEN + 4 + IHEX_FRAGMENT_SIZE] = ctx->rec_tail;
+		};
+	#elif defined(IHEX_STREAM_DECODE)
+		// bytes touched by the hex pairs after ':' so far, less the last of an over long line which was not kept
+		dst[24] = ctx->line_flags;
+		dst[25] = ctx->checksum;
+		memset(&dst[CKPT_HEADER_LEN], 0, partial);
+		memcpy(&dst[CKPT_HEADER_LEN], ctx->data_buffer, (partial < (ctx->line_max-1)/2) ? partial:(ctx->line_max-1)/2);
+	#else
+		dst[24] = 0;
+		dst[25] = 0;
+		memcpy(&dst[CKPT_HEADER_LEN], ctx->text_buffer, partial);
+	#endif
+		retval = CKPT_HEADER_LEN + partial;
+		check = fletcher16(dst, retval);
+		dst[retval++] = check & 0xFF;
+		dst[retval++] = check >> 8;
+	};
+
+	return retval;
+}
+
+int ihex_restore(ihex_ctx_t *ctx, const uint8_t *src, int src_len)
+{
+	int err = IHEX_OK;
+	int text_size = 0;
+	int partial = 0;
+	uint32_t input_offset;
+
+	if(src_len < CKPT_HEADER_LEN + 2)
+		err = IHEX_ERR_LEN;
+
+	if(!err)
+	{
+		text_size = src[22] | (src[23] << 8);
+		partial = CKPT_PARTIAL(text_size);
+		if(src_len < CKPT_HEADER_LEN + partial + 2 || text_size > ctx->line_max)
+			err = IHEX_ERR_LEN;
+	};
+
+	if(!err && fletcher16(src, CKPT_HEADER_LEN + partial) != (src[CKPT_HEADER_LEN + partial] | (src[CKPT_HEADER_LEN + partial + 1] << 8)))
+		err = IHEX_ERR_CHECKSUM;
+
+	// the partial line is only meaningful to a build that keeps it in the same form
+	if(!err && (src[0] != IHEX_CHECKPOINT_VERSION || (text_size && (src[1] & (CKPT_DECODED | CKPT_FRAGMENTS)) != CKPT_FORM)))
+		err = IHEX_ERR_UNSUPPORTED_RECORD;
+
+	if(!err)
+	{
+		input_offset = get_u32(&src[6]);
+		ctx->err = IHEX_OK;
+		ctx->data_size = 0;
+		ctx->clip_size = 0;
+		ctx->eof = (src[1] & CKPT_EOF) != 0;
+		ctx->ext_lin_addr = get_u32(&src[2]);
+		ctx->line_count = get_u32(&src[10]);
+		ctx->line_offset = get_u32(&src[14]);
+		ctx->line_chars = input_offset - ctx->line_offset;
+		ctx->skip_lines = get_u32(&src[18]);
+		ctx->text_size = text_size;
+	#if defined(IHEX_FRAGMENT_SIZE)
+		ctx->line_flags = src[24];
+		ctx->checksum = src[25];
+		if(partial)
+		{
+			memcpy(ctx->rec_header, &src[CKPT_HEADER_LEN], 4);
+			memcpy(ctx->data_buffer, &src[CKPT_HEADER_LEN + 4], IHEX_FRAGMENT_SIZE);
+			ctx->rec_tail = src[CKPT_HEADER_LEN + 4 + IHEX_FRAGMENT_SIZE];
+		};
+	#elif defined(IHEX_STREAM_DECODE)
+		ctx->line_flags = src[24];
+		ctx->checksum = src[25];
+		memcpy(ctx->data_buffer, &src[CKPT_HEADER_LEN], (partial < (ctx->line_max-1)/2) ? partial:(ctx->line_max-1)/2);
+	#else
+		memcpy(ctx->text_buffer, &src[CKPT_HEADER_LEN], partial);
+	#endif
+	};
+
+	return err;
 }
 
 //********************************************************************************************************
 // Private functions
 //********************************************************************************************************
 
+#ifdef IHEX_STREAM_DECODE
+
 static int write_chunk(ihex_ctx_t *ctx, const char *src, int src_len)
 {
 	bool finished = false;
 	int accepted = 0;
-	char *dst = &ctx->text_buffer[ctx->text_size];
+	int mark = 0;
 	char c;
 
 	while((accepted < src_len) && !finished)
@@ -97,73 +479,275 @@ static int write_chunk(ihex_ctx_t *ctx, const char *src, int src_len)
 		c = src[accepted++];
 		if(c == '\n')
 		{
+			ctx->line_chars += accepted - mark;
+			mark = accepted;
 			if(ctx->text_size)
 			{
-				ctx->err = process_line(ctx);
-				finished = true;
+				ctx->err = end_line(ctx);
+				// in sink (or slot) mode carry on with the next line unless the sink is busy
+				finished = !HANDS_OVER(ctx) || ctx->err || ctx->data_size || ctx->eof;
 			};
 		}
 		else if(c != '\r')
 		{
-			if(ctx->text_size == IHEX_LINE_LEN_MAX)
+			if(ctx->skip_lines)
+				ctx->text_size = 1;		//	not decoded, only whether the line is blank matters
+			else if(ctx->text_size == ctx->line_max)
 			{
 				ctx->err = IHEX_ERR_LEN;
 				finished = true;
 			}
 			else
 			{
-				*dst++ = c;
+				decode_char(ctx, c);
 				ctx->text_size++;
+			#ifdef IHEX_FRAGMENT_SIZE
+				// a fragment is waiting for ihex_proceed() or a busy sink
+				finished = ctx->err || ctx->data_size;
+			#endif
 			};
 		};
 	};
 
+	ctx->line_chars += accepted - mark;
 	return ctx->err == 0 ? accepted:ctx->err;
 }
 
+#else
+
+//	Lines are found with memchr() (vectorised or word-at-a-time in most C libraries) and copied into text_buffer
+//	 as whole runs between CR characters, instead of one character at a time.
+static int write_chunk(ihex_ctx_t *ctx, const char *src, int src_len)
+{
+	bool finished = false;
+	const char *p = src;
+	const char *end = src + src_len;
+	const char *mark = src;
+	const char *lf, *stop, *cr;
+	int n;
+
+	while(p < end && !finished)
+	{
+		lf = memchr(p, '\n', end - p);
+		stop = lf ? lf:end;
+
+		// CR is ignored wherever it is
+		while(p < stop && !ctx->err)
+		{
+			cr = memchr(p, '\r', stop - p);
+			n = (cr ? cr:stop) - p;
+			if(ctx->skip_lines)
+				ctx->text_size |= (n != 0);		//	not kept, only whether the line is blank matters
+			else if(n > ctx->line_max - ctx->text_size)
+				ctx->err = IHEX_ERR_LEN;
+			else
+			{
+				memcpy(&ctx->text_buffer[ctx->text_size], p, n);
+				ctx->text_size += n;
+			};
+			if(!ctx->err)
+				p = cr ? cr+1:stop;
+		};
+
+		finished = ctx->err;
+		if(lf && !finished)
+		{
+			p = lf + 1;
+			ctx->line_chars += p - mark;
+			mark = p;
+			if(ctx->text_size)
+			{
+				ctx->err = end_line(ctx);
+				// in sink (or slot) mode carry on with the next line unless the sink is busy
+				finished = !HANDS_OVER(ctx) || ctx->err || ctx->data_size || ctx->eof;
+			};
+		};
+	};
+
+	ctx->line_chars += p - mark;
+	return ctx->err == 0 ? (int)(p - src):ctx->err;
+}
+
+#endif
+
+#ifdef IHEX_STREAM_DECODE
+
+//	The line has already been decoded by decode_char(), apply the remaining checks in process_line() order
+static int process_line(ihex_ctx_t *ctx)
+{
+	int err = IHEX_OK;
+	int text_size = ctx->text_size;
+	uint8_t line_flags = ctx->line_flags;
+	uint8_t checksum = ctx->checksum;
+
+	ctx->text_size = 0;
+	ctx->line_flags = 0;
+	ctx->checksum = 0;
+
+	if(line_flags & LINE_BAD_START)
+		err = IHEX_ERR_START;
+
+	if(!err && (text_size % 2 == 0 || text_size < MIN_VALID_LINE_LEN))
+		err = IHEX_ERR_LEN;
+
+	if(!err && (line_flags & LINE_BAD_HEX))
+		err = IHEX_ERR_HEX;
+
+	if(!err)
+		err = process_record(ctx, (text_size-1)/2, checksum);
+
+	return err;
+}
+
+#else
+
 static int process_line(ihex_ctx_t *ctx)
+{
+	int text_size = ctx->text_size;
+
+	ctx->text_size = 0;
+	return process_text(ctx, ctx->text_buffer, text_size);
+}
+
+//	Check and decode one line of text_size characters (without CR/LF) into data_buffer.
+//	text is either text_buffer (decoded in place) or the caller's input (ihex_parse_buffer()).
+static int process_text(ihex_ctx_t *ctx, const char *text, int text_size)
 {
 	int err = IHEX_OK;
 	int byte_count;
-	int data_length;
-	int record_type;
-	int i;
-	uint8_t checksum;
+	uint8_t checksum = 0;
 
-	if(ctx->text_buffer[0] != ':')
+	if(text[0] != ':')
 		err = IHEX_ERR_START;
 	
-	if(!err && (ctx->text_size % 2 == 0 || ctx->text_size < MIN_VALID_LINE_LEN))
+	if(!err && (text_size % 2 == 0 || text_size < MIN_VALID_LINE_LEN))
 		err = IHEX_ERR_LEN;
 
 	if(!err)
 	{
-		byte_count = (ctx->text_size-1)/2;
-		ctx->text_size = 0;
-		err = ascii2raw(ctx->data_buffer, &ctx->text_buffer[1], byte_count);
+		byte_count = (text_size-1)/2;
+		err = ascii2raw(ctx->data_buffer, &text[1], byte_count, &checksum);
 	};
 
 	if(!err)
+		err = process_record(ctx, byte_count, checksum);
+
+	return err;
+}
+
+//	Zero copy path of ihex_parse_buffer(), complete lines are decoded straight from src.
+//	Stops where write_chunk() would stop accepting input, or at a line it has to handle
+//	 (split across calls, or with CR characters inside it). Returns the number of characters consumed.
+static long parse_lines(ihex_ctx_t *ctx, const char *src, long src_len)
+{
+	const char *p = src;
+	const char *end = src + src_len;
+	const char *lf, *first, *last;
+	bool finished = false;
+	long n;
+	int r;
+
+	while(!finished && (lf = memchr(p, '\n', end - p)) != NULL)
 	{
-		data_length = ctx->data_buffer[0];
-		
-		if(data_length != byte_count - MIN_VALID_BYTE_COUNT)
-			err = IHEX_ERR_LEN;
+		// CR is ignored, trim CRLF and LFCR endings
+		first = p;
+		last = lf;
+		while(first < last && *first == '\r')
+			first++;
+		while(last > first && last[-1] == '\r')
+			last--;
+
+		if(memchr(first, '\r', last - first))
+			break;
+
+		ctx->line_chars += lf + 1 - p;
+		if(last != first && ctx->skip_lines)
+			skip_line(ctx);
+		else if(last - first > ctx->line_max)
+			ctx->err = IHEX_ERR_LEN;
+		else if(last != first)
+		{
+			ctx->err = process_text(ctx, first, (int)(last - first));
+			if(!ctx->err)
+				next_line(ctx);
+		};
+		p = lf + 1;
+		finished = ctx->err || ctx->data_size || ctx->eof;
 	};
 
-	if(!err)
+	// a line left incomplete, or needing CRs stripped, goes through write_chunk()
+	if(!finished && p < end)
 	{
-		checksum = 0;
-		i = byte_count;
-		while(i--)
-			checksum += ctx->data_buffer[i];
-		if(checksum != 0x00)
-			err = IHEX_ERR_CHECKSUM;
+		lf = memchr(p, '\n', end - p);
+		n = (lf ? lf+1 : end) - p;
+		r = write_chunk(ctx, p, n > INT_MAX ? INT_MAX:(int)n);
+		if(r > 0)
+			p += r;
 	};
 
+	return p - src;
+}
+
+#endif
+
+//	A non blank line has been taken, up to and including its LF
+static int end_line(ihex_ctx_t *ctx)
+{
+	int err = IHEX_OK;
+
+	if(ctx->skip_lines)
+		skip_line(ctx);
+	else
+	{
+		err = process_line(ctx);
+		if(!err)
+			next_line(ctx);
+	};
+
+	return err;
+}
+
+static void next_line(ihex_ctx_t *ctx)
+{
+	ctx->line_count++;
+	ctx->line_offset += ctx->line_chars;
+	ctx->line_chars = 0;
+}
+
+//	Resent ahead of the line that failed, and already parsed once. Its characters are not counted again.
+static void skip_line(ihex_ctx_t *ctx)
+{
+	ctx->skip_lines--;
+	ctx->line_chars = 0;
+	clear_line(ctx);
+}
+
+static void clear_line(ihex_ctx_t *ctx)
+{
+	ctx->text_size = 0;
+#ifdef IHEX_STREAM_DECODE
+	ctx->line_flags = 0;
+	ctx->checksum = 0;
+#endif
+}
+
+//	data_buffer holds the decoded record (LL AAAA TT DD.. CC)
+static int process_record(ihex_ctx_t *ctx, int byte_count, uint8_t checksum)
+{
+	int err = IHEX_OK;
+	int data_length;
+	int record_type;
+
+	data_length = REC_HEADER(ctx)[0];
+	if(data_length != byte_count - MIN_VALID_BYTE_COUNT)
+		err = IHEX_ERR_LEN;
+
+	if(!err && checksum != 0x00)
+		err = IHEX_ERR_CHECKSUM;
+
 	if(!err)
 	{
-		record_type = ctx->data_buffer[3];
+		record_type = REC_HEADER(ctx)[3];
 		switch(record_type)
 		{
 			case 0x00: err = process_rec_data(ctx); break;
@@ -179,20 +763,193 @@ static int process_line(ihex_ctx_t *ctx)
 
 static int process_rec_data(ihex_ctx_t *ctx)
 {
-	ctx->data_address = (ctx->data_buffer[1] << 8) + ctx->data_buffer[2];
-	ctx->data_address |= ctx->ext_lin_addr;
-	ctx->data_size = ctx->data_buffer[0];
-	memmove(ctx->data_buffer, &ctx->data_buffer[4], ctx->data_size);
-	return IHEX_OK;
+	uint32_t address = ((REC_HEADER(ctx)[1] << 8) + REC_HEADER(ctx)[2]) | ctx->ext_lin_addr;
+	int size = REC_HEADER(ctx)[0];
+	int offset = 0;
+#ifdef IHEX_FRAGMENT_SIZE
+	int end;
+
+	// the fragments before the last have gone already
+	if(size)
+		offset = ((size-1) / IHEX_FRAGMENT_SIZE) * IHEX_FRAGMENT_SIZE;
+
+	// or the one with the last byte in a window was held back to carry the commit, see decode_char()
+	if(offset && ctx->window_count && (end = windowed_end(ctx, address, size)) <= offset)
+	{
+		offset = end ? ((end-1) / IHEX_FRAGMENT_SIZE) * IHEX_FRAGMENT_SIZE : 0;
+		size = offset + IHEX_FRAGMENT_SIZE;
+	};
+#endif
+
+	return surface_data(ctx, address + offset, size - offset, true);
+}
+
+//	Hand size bytes of payload at address (REC_PAYLOAD() onwards) to the host, a piece per window it overlaps.
+//	last is false for a fragment of a line still being decoded.
+static int surface_data(ihex_ctx_t *ctx, uint32_t address, int size, bool last)
+{
+	ctx->data_address = address;
+	ctx->clip_address = address;
+	ctx->clip_next = 0;
+	ctx->clip_size = ctx->window_count ? windowed_end(ctx, address, size):size;
+	ctx->clip_last = last;
+
+	// the record was fully checked, it is only counted if some of it is wanted
+	if(ctx->manifest && last && (ctx->clip_size || size == 0))
+		ctx->manifest->records++;
+
+	return surface_piece(ctx);
+}
+
+//	Surface the next piece of the record, from clip_next to the end of the window run there (to clip_size without
+//	 windows). Pieces go on to the sink, or into the manifest, until the record is done or the sink is busy.
+//	Otherwise ihex_proceed() brings the next one.
+//	Pieces come in address order, so moving one to the start of data_buffer never overwrites the payload of the next.
+static int surface_piece(ihex_ctx_t *ctx)
+{
+	int err = IHEX_OK;
+	uint32_t address;
+	int size;
+
+	while(err == IHEX_OK && ctx->data_size == 0 && ctx->clip_next < ctx->clip_size)
+	{
+		address = ctx->clip_address + ctx->clip_next;
+		size = ctx->clip_size - ctx->clip_next;
+		// clip_size ends on a byte in a window, so there is always a piece
+		if(ctx->window_count)
+			clip_to_windows(ctx, &address, &size);
+		ctx->clip_next = (int)(address - ctx->clip_address) + size;
+
+		// pre-scan, the payload is neither moved nor surfaced
+		if(ctx->manifest)
+			note_record(ctx->manifest, address, size);
+		else
+		{
+			memmove(ctx->data_buffer, &REC_PAYLOAD(ctx)[address - ctx->clip_address], size);
+			ctx->data_address = address;
+			ctx->data_size = size;
+		#ifdef IHEX_FRAGMENT_SIZE
+			ctx->data_commit = ctx->clip_last && ctx->clip_next == ctx->clip_size;
+		#endif
+			if(HANDS_OVER(ctx))
+				err = deliver_data(ctx);
+		};
+	};
+
+	return err;
+}
+
+//	Narrow the record to its first run of bytes inside the windows (windows that overlap or touch make one run).
+//	Returns false if it overlaps none.
+static bool clip_to_windows(const ihex_ctx_t *ctx, uint32_t *address, int *size)
+{
+	uint64_t rec_end = (uint64_t)*address + *size;
+	uint64_t win_end;
+	uint64_t first = rec_end;
+	uint64_t last;
+	const ihex_window_t *w;
+	bool grown = true;
+	int i;
+
+	for(i=0; i < ctx->window_count; i++)
+	{
+		w = &ctx->windows[i];
+		win_end = (uint64_t)w->address + w->size;
+		if(w->size && w->address < first && win_end > *address)
+			first = (w->address > *address) ? w->address:*address;
+	};
+
+	// extend over the windows that carry on from there
+	last = first;
+	while(grown)
+	{
+		grown = false;
+		for(i=0; i < ctx->window_count; i++)
+		{
+			w = &ctx->windows[i];
+			win_end = (uint64_t)w->address + w->size;
+			if(w->address <= last && win_end > last)
+			{
+				last = win_end;
+				grown = true;
+			};
+		};
+	};
+	if(last > rec_end)
+		last = rec_end;
+
+	if(last > first)
+	{
+		*size = (int)(last - first);
+		*address = (uint32_t)first;
+	};
+	return last > first;
+}
+
+//	Bytes of the record up to and including the last one inside a window, 0 if it overlaps none
+static int windowed_end(const ihex_ctx_t *ctx, uint32_t address, int size)
+{
+	uint64_t rec_end = (uint64_t)address + size;
+	uint64_t win_end;
+	uint64_t end = address;
+	const ihex_window_t *w;
+	int i;
+
+	for(i=0; i < ctx->window_count; i++)
+	{
+		w = &ctx->windows[i];
+		win_end = (uint64_t)w->address + w->size;
+		if(w->size && w->address < rec_end && win_end > end)
+			end = (win_end < rec_end) ? win_end:rec_end;
+	};
+
+	return (int)(end - address);
+}
+
+static void note_record(ihex_manifest_t *m, uint32_t address, int size)
+{
+	uint32_t last = address + size - 1;
+	uint64_t end, lo, hi;
+	uint32_t first_page, last_page;
+
+	if(size)
+	{
+		if(m->data_bytes == 0 || address < m->min_address)
+			m->min_address = address;
+		if(m->data_bytes == 0 || last > m->max_address)
+			m->max_address = last;
+		m->data_bytes += size;
+
+		// the part of the record over the bitmap marks its pages, only an overhang counts as outside
+		if(m->pages)
+		{
+			end = (uint64_t)m->page_base + (uint64_t)m->page_size * m->page_count;
+			lo = (address > m->page_base) ? address : m->page_base;
+			hi = ((uint64_t)last + 1 < end) ? (uint64_t)last + 1 : end;
+			if(address < m->page_base || (uint64_t)last >= end)
+				m->outside = true;
+			if(lo < hi)
+			{
+				first_page = (uint32_t)((lo - m->page_base) / m->page_size);
+				last_page = (uint32_t)((hi - 1 - m->page_base) / m->page_size);
+				for(; first_page <= last_page; first_page++)
+					m->pages[first_page / 32] |= (uint32_t)1 << (first_page % 32);
+			};
+		};
+	};
 }
 
 static int process_rec_eof(ihex_ctx_t *ctx)
 {
 	static const uint8_t expected_bytes[3] = {0x00, 0x00, 0x00};
-	int err = (memcmp(expected_bytes, ctx->data_buffer, sizeof(expected_bytes))==0) ? IHEX_OK:IHEX_ERR_EOF;
+	int err = (memcmp(expected_bytes, REC_HEADER(ctx), sizeof(expected_bytes))==0) ? IHEX_OK:IHEX_ERR_EOF;
 
 	if(!err)
+	{
 		ctx->eof = true;
+		if(ctx->on_eof)
+			ctx->on_eof(ctx->user);
+	};
 
 	return err;
 }
@@ -200,39 +957,263 @@ static int process_rec_eof(ihex_ctx_t *ctx)
 static int process_rec_ext_lin_add(ihex_ctx_t *ctx)
 {
 	static const uint8_t expected_bytes[3] = {0x02, 0x00, 0x00};
-	int err = (memcmp(expected_bytes, ctx->data_buffer, sizeof(expected_bytes))==0) ? IHEX_OK:IHEX_ERR_EXT_ADDR;
+	int err = (memcmp(expected_bytes, REC_HEADER(ctx), sizeof(expected_bytes))==0) ? IHEX_OK:IHEX_ERR_EXT_ADDR;
 
 	if(!err)
-		ctx->ext_lin_addr = ((uint32_t)ctx->data_buffer[4] << 24) | ((uint32_t)ctx->data_buffer[5] << 16);
+		ctx->ext_lin_addr = ((uint32_t)REC_PAYLOAD(ctx)[0] << 24) | ((uint32_t)REC_PAYLOAD(ctx)[1] << 16);
 
 	return err;
 }
 
 
-static int ascii2raw(uint8_t *dst, const char *src, int byte_count)
+//	Re-offer a record the sink was too busy to take, then report whether more input can be accepted
+static bool accepting(ihex_ctx_t *ctx)
+{
+	if(ctx->err == IHEX_OK && ctx->data_size && HANDS_OVER(ctx))
+	{
+		ctx->err = deliver_data(ctx);
+		// then the pieces left of a record that overlaps several windows
+		if(ctx->err == IHEX_OK)
+			ctx->err = surface_piece(ctx);
+	};
+
+	return ctx->err == IHEX_OK && ctx->eof == false && ctx->data_size == 0;
+}
+
+//	Offer the pending data record to the sink (or a free slot), it stays pending (data_size non0) while the sink is busy
+static int deliver_data(ihex_ctx_t *ctx)
+{
+	int r;
+#ifdef IHEX_SLOTS
+	ihex_slot_t *slot;
+
+	if(!ctx->on_data)
+	{
+		r = IHEX_SINK_BUSY;
+		if(ctx->slot_count < IHEX_SLOTS)
+		{
+			slot = &ctx->slots[(ctx->slot_head + ctx->slot_count) % IHEX_SLOTS];
+			slot->address = ctx->data_address;
+			slot->size = ctx->data_size;
+			memcpy(slot->data, ctx->data_buffer, ctx->data_size);
+		#ifdef IHEX_FRAGMENT_SIZE
+			slot->commit = ctx->data_commit;
+		#endif
+			ctx->slot_count++;
+			r = IHEX_OK;
+		};
+	}
+	else
+#endif
+	r = ctx->on_data(ctx->user, ctx->data_address, ctx->data_buffer, ctx->data_size);
+
+	if(r == IHEX_OK)
+		ctx->data_size = 0;
+
+	return r < 0 ? r:IHEX_OK;
+}
+
+#if defined(IHEX_FRAGMENT_SIZE)
+
+//	Decode one character of the current line (text_size is its position). The header is kept in rec_header, payload
+//	 bytes fold into data_buffer, which is surfaced each time it fills while more of the record is still to come.
+//	The last fragment waits for the checksum, see process_rec_data(). With windows, so does the fragment holding the
+//	 last byte in a window (LINE_HELD), so that the commit always comes with a fragment the host is given.
+static void decode_char(ihex_ctx_t *ctx, char c)
+{
+	uint32_t address;
+	uint8_t *dst;
+	int8_t n;
+	int i, p;
+
+	if(ctx->text_size == 0)
+	{
+		if(c != ':')
+			ctx->line_flags |= LINE_BAD_START;
+	}
+	else
+	{
+		n = hex_nibble(c);
+		i = (ctx->text_size-1)/2;
+		p = i - 4;
+		if(i < 4)
+			dst = &ctx->rec_header[i];
+		else if(p < ctx->rec_header[0])
+			dst = (ctx->line_flags & LINE_HELD) ? &ctx->rec_tail : &ctx->data_buffer[p % IHEX_FRAGMENT_SIZE];
+		else
+			dst = &ctx->rec_tail;		//	checksum, or too long to be valid and LEN is reported at LF
+
+		if(n == -1)
+			ctx->line_flags |= LINE_BAD_HEX;
+		else if(ctx->text_size & 1)
+			*dst = (uint8_t)n << 4;
+		else
+		{
+			*dst |= (uint8_t)n;
+			ctx->checksum += *dst;
+			if(p >= 0 && (p+1) % IHEX_FRAGMENT_SIZE == 0 && p+1 < ctx->rec_header[0] && ctx->rec_header[3] == 0x00 && !ctx->line_flags)
+			{
+				address = ((ctx->rec_header[1] << 8) + ctx->rec_header[2]) | ctx->ext_lin_addr;
+				// nothing after this fragment is in a window, the rest of the payload is only summed
+				if(ctx->window_count && windowed_end(ctx, address, ctx->rec_header[0]) <= p+1)
+					ctx->line_flags |= LINE_HELD;
+				else
+					ctx->err = surface_data(ctx, address + p+1 - IHEX_FRAGMENT_SIZE, IHEX_FRAGMENT_SIZE, false);
+			};
+		};
+	};
+}
+
+#elif defined(IHEX_STREAM_DECODE)
+
+//	Decode one character of the current line (text_size is its position) straight into data_buffer
+static void decode_char(ihex_ctx_t *ctx, char c)
+{
+	int8_t n;
+	int i;
+
+	if(ctx->text_size == 0)
+	{
+		if(c != ':')
+			ctx->line_flags |= LINE_BAD_START;
+	}
+	else
+	{
+		n = hex_nibble(c);
+		i = (ctx->text_size-1)/2;
+		if(n == -1)
+			ctx->line_flags |= LINE_BAD_HEX;
+		else if(i < (ctx->line_max-1)/2)	// else the line is too long to be valid, LEN is reported at LF
+		{
+			if(ctx->text_size & 1)
+				ctx->data_buffer[i] = (uint8_t)n << 4;
+			else
+			{
+				ctx->data_buffer[i] |= (uint8_t)n;
+				ctx->checksum += ctx->data_buffer[i];
+			};
+		};
+	};
+}
+
+#else
+
+//	Decode byte_count bytes from 2*byte_count hex characters, summing them into *checksum in the same pass.
+//	dst may alias src (dst <= src), the line is decoded in place.
+static int ascii2raw(uint8_t *dst, const char *src, int byte_count, uint8_t *checksum)
 {
 	int err = IHEX_OK;
-	int8_t h;
+#if IHEX_DECODE_KERNEL != IHEX_DECODE_SWAR
+	int8_t h, l;
+#endif
+	uint8_t sum = 0;
 
-	while(byte_count-- && err == IHEX_OK)
+#ifdef IHEX_SIMD
+	int done = ihex_simd_decode(dst, src, byte_count, &sum);
+	if(done < 0)
+		err = done;
+	else
 	{
-		h = hex_nibble(*src++);
-		if(h == -1)
-			err = IHEX_ERR_HEX;
-		*dst =  h << 4;
+		dst += done;
+		src += 2*done;
+		byte_count -= done;
+	};
+#endif
+
+#if IHEX_DECODE_KERNEL == IHEX_DECODE_SWAR
+	uint32_t bad = 0;
+	uint32_t n;
+
+	uint32_t w;
 
+	// 2 bytes per 32 bit word
+	while(byte_count > 1)
+	{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		memcpy(&w, src, 4);
+#else
+		w = (uint32_t)(uint8_t)src[0] | ((uint32_t)(uint8_t)src[1] << 8) | ((uint32_t)(uint8_t)src[2] << 16) | ((uint32_t)(uint8_t)src[3] << 24);
+#endif
+		n = swar_decode(w, &bad);
+		dst[0] = (uint8_t)n;
+		dst[1] = (uint8_t)(n >> 16);
+		sum += dst[0] + dst[1];
+		dst += 2;
+		src += 4;
+		byte_count -= 2;
+	};
+
+	// an odd last byte is padded with "00"
+	if(byte_count == 1)
+	{
+		w = (uint32_t)(uint8_t)src[0] | ((uint32_t)(uint8_t)src[1] << 8) | 0x30300000;
+		*dst = (uint8_t)swar_decode(w, &bad);
+		sum += *dst;
+	};
+
+	if(bad)
+		err = IHEX_ERR_HEX;
+#elif IHEX_DECODE_KERNEL == IHEX_DECODE_LUT
+	uint8_t bad = 0;
+
+	while(byte_count-- > 0)
+	{
+		h = nibble_lut[(uint8_t)*src++];
+		l = nibble_lut[(uint8_t)*src++];
+		bad |= (uint8_t)(h | l);	// only invalid characters set the upper nibble
+		*dst = (uint8_t)(((uint8_t)h << 4) | ((uint8_t)l & 0x0F));
+		sum += *dst++;
+	};
+	if(bad & 0xF0)
+		err = IHEX_ERR_HEX;
+#else
+	while(byte_count-- && err == IHEX_OK)
+	{
 		h = hex_nibble(*src++);
-		if(h == -1)
+		l = hex_nibble(*src++);
+		if(h == -1 || l == -1)
 			err = IHEX_ERR_HEX;
-		*dst |=  h;
-		dst++;
+		*dst = (uint8_t)(((uint8_t)h << 4) | (uint8_t)l);
+		sum += *dst++;
 	};
+#endif
 
+	*checksum = sum;
 	return err;
 }
 
+#if IHEX_DECODE_KERNEL == IHEX_DECODE_SWAR
+
+//	Decode 4 hex characters (first one in bits 0-7), the 2 bytes come back in bits 0-7 and 16-23.
+//	Each byte lane is classified with additions that set bit 7 at a range boundary: 0x30 ('0') + 0x50 = 0x80,
+//	 0x3A + 0x46 = 0x80, and likewise for 'a' and 'g' after folding to lower case. Masking to 7 bits first keeps
+//	 carries inside their lane, characters with bit 7 set are flagged directly. Invalid lanes are ORed into *bad.
+static uint32_t swar_decode(uint32_t w, uint32_t *bad)
+{
+	uint32_t lower, digit, letter, nine, n;
+
+	*bad |= w & 0x80808080;
+	w &= 0x7F7F7F7F;
+	lower = w | 0x20202020;
+	digit = (w + 0x50505050) & ~(w + 0x46464646);
+	letter = (lower + 0x1F1F1F1F) & ~(lower + 0x19191919);
+	*bad |= ~(digit | letter) & 0x80808080;
+
+	// '0'-'9' have their value in the low nibble, letters are 9 more (shift and add, M0+ may have a slow multiplier)
+	nine = (letter >> 7) & 0x01010101;
+	n = (w & 0x0F0F0F0F) + (nine << 3) + nine;
+	return (n << 4) | (n >> 8);
+}
+
+#endif
+
+#endif
+
 static int8_t hex_nibble(uint8_t c)
 {
+#if IHEX_DECODE_KERNEL == IHEX_DECODE_LUT
+    return (int8_t)nibble_lut[c];
+#else
     uint8_t d = c - '0';
     if (d <= 9) return (int8_t)d;
 
@@ -241,4 +1222,32 @@ static int8_t hex_nibble(uint8_t c)
     if (d <= 5) return (int8_t)(d + 10);
 
     return -1;
-}
\ No newline at end of file
+#endif
+}
+
+static void put_u32(uint8_t *dst, uint32_t v)
+{
+	dst[0] = v & 0xFF;
+	dst[1] = (v >> 8) & 0xFF;
+	dst[2] = (v >> 16) & 0xFF;
+	dst[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *src)
+{
+	return src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static uint16_t fletcher16(const uint8_t *src, int len)
+{
+	uint16_t a = 0;
+	uint16_t b = 0;
+	int i;
+
+	for(i=0; i < len; i++)
+	{
+		a = (a + src[i]) % 255;
+		b = (b + a) % 255;
+	};
+	return (b << 8) | a;
+}
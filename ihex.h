@@ -3,6 +3,7 @@
 
 	#include <stdint.h>
 	#include <stdbool.h>
+	#include <stddef.h>
 
 //********************************************************************************************************
 // Public defines
@@ -13,8 +14,51 @@
 		#warning "Using default IHEX_LINE_LEN_MAX of 521, define IHEX_LINE_LEN_MAX to remove this warning"
 	#endif
 
+//	Scalar hex decode (ascii2raw(), and the tail of each line with IHEX_SIMD), select with IHEX_DECODE_KERNEL:
+//	 IHEX_DECODE_BRANCH		compare and branch per character, smallest code (default)
+//	 IHEX_DECODE_LUT		256 byte const table (flash), no branches per character, also used by IHEX_STREAM_DECODE
+//	 IHEX_DECODE_SWAR		4 characters per 32 bit word with SWAR arithmetic, no table and no branches per character
+//	The LUT and SWAR kernels validate the whole line into an error mask, checked once at the end.
+	#define IHEX_DECODE_BRANCH	0
+	#define IHEX_DECODE_LUT		1
+	#define IHEX_DECODE_SWAR	2
 
-//	Errors are latching, and prevent further decode until the context is re-initialised with ihex_init()
+	#ifndef IHEX_DECODE_KERNEL
+		#define IHEX_DECODE_KERNEL	IHEX_DECODE_BRANCH
+	#endif
+
+//	Define IHEX_STREAM_DECODE to decode each hex pair as it arrives instead of buffering the line text.
+//	This removes text_buffer (roughly halving the context) and spreads the decode work evenly across ihex_write() calls.
+//	Behaviour and error codes are unchanged.
+
+//	Define IHEX_FRAGMENT_SIZE (2 or more) to surface data record payload in fragments of that many bytes as soon as
+//	 they are decoded, so records of any length (up to 255 bytes) are accepted with a context sized for one fragment.
+//	Implies IHEX_STREAM_DECODE. A fragment is provisional until its line has passed every check, the last fragment of
+//	 each record (the last one inside a window, see ihex_set_windows()) comes with ctx.data_commit set once it has.
+//	 If the line fails instead, the error is reported as usual and the host drops the fragments since the last commit
+//	 (those of line ctx.line_count).
+#ifdef IHEX_FRAGMENT_SIZE
+	#ifndef IHEX_STREAM_DECODE
+		#define IHEX_STREAM_DECODE
+	#endif
+	#if IHEX_FRAGMENT_SIZE < 2
+		#error "IHEX_FRAGMENT_SIZE must be 2 or more"
+	#endif
+#endif
+
+//	Longest line accepted, not counting CR/LF (IHEX_FRAGMENT_SIZE builds take any valid line, whatever IHEX_LINE_LEN_MAX)
+#ifdef IHEX_FRAGMENT_SIZE
+	#define IHEX_TEXT_LEN_MAX		521
+#else
+	#define IHEX_TEXT_LEN_MAX		IHEX_LINE_LEN_MAX
+#endif
+
+
+//	Define IHEX_SLOTS as 2 or more to allow queueing up to that many data records for the host, see ihex_init_slots().
+//	Each slot takes about IHEX_LINE_LEN_MAX/2 bytes of RAM.
+
+//	Errors are latching, and prevent further decode until the context is re-initialised with ihex_init(),
+//	 or until ihex_retry() discards the failing line.
 	#define IHEX_OK						 0
 	#define IHEX_ERR_HEX				-1
 	#define IHEX_ERR_LEN				-2
@@ -23,11 +67,76 @@
 	#define IHEX_ERR_EXT_ADDR			-5
 	#define IHEX_ERR_EOF				-6
 	#define IHEX_ERR_START				-7
+	#define IHEX_ERR_IO					-8
+	#define IHEX_ERR_OVERLAP			-9
+	#define IHEX_ERR_FULL				-10
+
+//	Sink callback return value, the record is offered again on the next ihex_write()
+	#define IHEX_SINK_BUSY				1
+
+//	Largest blob written by ihex_checkpoint(), fixed fields plus a partial line.
+//	A context from ihex_init_ex() may need up to 28 + its max_line instead.
+	#define IHEX_CHECKPOINT_VERSION		1
+#ifdef IHEX_FRAGMENT_SIZE
+	#define IHEX_CHECKPOINT_MAX			(33 + IHEX_FRAGMENT_SIZE)
+#else
+	#define IHEX_CHECKPOINT_MAX			(28 + IHEX_LINE_LEN_MAX)
+#endif
 
 //********************************************************************************************************
 // Public variables
 //********************************************************************************************************
 
+//	Sink callbacks, see ihex_init_sink()
+//	on_data returns IHEX_OK once the record has been consumed, IHEX_SINK_BUSY to apply backpressure,
+//	 or an IHEX_ERR_# code which latches as the parsing error.
+	typedef int (*ihex_data_fn)(void *user, uint32_t address, const uint8_t *data, int size);
+	typedef void (*ihex_eof_fn)(void *user);
+
+#ifdef IHEX_SLOTS
+	typedef struct ihex_slot_t
+	{
+		uint32_t address;		//	includes extended linear address from 0x04 records
+		int size;
+	#ifdef IHEX_FRAGMENT_SIZE
+		bool commit;			//	last fragment of a record, see IHEX_FRAGMENT_SIZE
+		uint8_t data[IHEX_FRAGMENT_SIZE];
+	#else
+		uint8_t data[(IHEX_LINE_LEN_MAX-11)/2];
+	#endif
+	} ihex_slot_t;
+#endif
+
+//	What a pre-scan (ihex_init_scan()) found, for erasing ahead of programming
+	typedef struct ihex_manifest_t
+	{
+//		Host use:
+		uint32_t min_address;	//	lowest data byte, valid if data_bytes non0
+		uint32_t max_address;	//	highest data byte
+		uint32_t data_bytes;	//	total payload
+		uint32_t records;		//	data records
+		bool outside;			//	some data fell outside the page bitmap
+//		Host supplied page bitmap, bit n (pages[n/32] bit n%32) is set if page_base + n*page_size holds data
+		uint32_t *pages;
+		uint32_t page_base;
+		uint32_t page_size;
+		uint32_t page_count;
+	} ihex_manifest_t;
+
+//	Address range for ihex_set_windows(), size bytes from address
+	typedef struct ihex_window_t
+	{
+		uint32_t address;
+		uint32_t size;
+	} ihex_window_t;
+
+//	One span of input for ihex_writev()
+	typedef struct ihex_iovec_t
+	{
+		const char *base;
+		int len;
+	} ihex_iovec_t;
+
 	typedef struct ihex_ctx_t
 	{
 //		Host use:
@@ -35,14 +144,53 @@
 		uint32_t data_address;	//  (includes extended linear address from 0x04 records)
 		bool eof;				//	indicates end of file record was parsed.
 		int err;				//	parsing error, also returned by ihex_write if non0
+		uint32_t line_count;	//	lines parsed (blank lines not counted), on error the 0 based number of the failing line
+		uint32_t line_offset;	//	input offset of the first character of line line_count
+	#ifdef IHEX_FRAGMENT_SIZE
+		uint8_t data_buffer[IHEX_FRAGMENT_SIZE];			// host reads data from data records here, a fragment at a time
+		bool data_commit;		//	the line of this (last) fragment has been checked, see IHEX_FRAGMENT_SIZE
+	#endif
+//		Internal use:
+	#ifdef IHEX_FRAGMENT_SIZE
+		uint8_t rec_header[4];	//	LL AAAA TT of the line being decoded
+		uint8_t rec_tail;		//	checksum byte
+	#endif
+	#ifdef IHEX_STREAM_DECODE
+		uint8_t checksum;		//	running sum of the bytes decoded so far
+		uint8_t line_flags;		//	problems seen so far in the current line
+	#endif
+		int line_max;			//	longest line accepted, IHEX_TEXT_LEN_MAX unless sized by ihex_init_ex()
+		int text_size;
+		uint32_t line_chars;	//	characters taken since line_offset
+		uint32_t skip_lines;	//	lines resent ahead of the failing one, see ihex_retry()
+		uint32_t ext_lin_addr;
+		ihex_data_fn on_data;
+		ihex_eof_fn on_eof;
+		void *user;
+		ihex_manifest_t *manifest;	//	pre-scan, see ihex_init_scan()
+		const ihex_window_t *windows;	//	see ihex_set_windows()
+		int window_count;
+		uint32_t clip_address;	//	record being surfaced a window at a time, REC_PAYLOAD() is at this address
+		int clip_next;			//	payload offset of the next piece
+		int clip_size;			//	payload up to the last byte in a window
+		bool clip_last;			//	last fragment of its line
+	#ifdef IHEX_SLOTS
+		bool slotted;			//	records go to the slots, see ihex_init_slots()
+		ihex_slot_t slots[IHEX_SLOTS];
+		int slot_head;			//	oldest record
+		int slot_count;
+	#endif
+//		Line sized buffer, last so that ihex_init_ex() can size it at runtime:
+	#if defined(IHEX_STREAM_DECODE) && !defined(IHEX_FRAGMENT_SIZE)
+		uint8_t data_buffer[(IHEX_LINE_LEN_MAX-1)/2];		// host reads data from data records here
+	#elif !defined(IHEX_STREAM_DECODE)
 		union
 		{
 			uint8_t data_buffer[(IHEX_LINE_LEN_MAX-1)/2];	// host reads data from data records here
 //		Internal use:
 			char text_buffer[IHEX_LINE_LEN_MAX];
 		};
-		int text_size;
-		uint32_t ext_lin_addr;
+	#endif
 	} ihex_ctx_t;
 
 //********************************************************************************************************
@@ -51,6 +199,46 @@
 
 	void ihex_init(ihex_ctx_t *ctx);
 
+//	Bytes needed for a context taking lines of up to max_line characters (11 to 521), whatever IHEX_LINE_LEN_MAX is.
+//	The size is rounded up so contexts can be laid out back to back in one allocation.
+	size_t ihex_ctx_size(int max_line);
+
+//	Initialise a context in caller supplied memory of size bytes (from ihex_ctx_size()), as ihex_init().
+//	Returns the context, or NULL if size is too small for any valid line.
+//	Such a context may be smaller than sizeof(ihex_ctx_t), so the other ihex_init_#() functions (which clear a whole
+//	 ihex_ctx_t) must not be used on it: choose a mode with ihex_set_sink() or ihex_set_scan() instead.
+	ihex_ctx_t* ihex_init_ex(void *mem, size_t size);
+
+//	Initialise in sink mode. Data records are passed to on_data() as they are parsed and ihex_write() keeps going
+//	 through the whole input instead of stopping after each line. ihex_proceed() is not used.
+//	If on_data() returns IHEX_SINK_BUSY, ihex_write() returns early, leaving the record pending (ctx.data_size non0).
+//	 The next ihex_write() offers it again before accepting any more input, returning 0 if the sink is still busy.
+//	on_eof() may be NULL.
+	void ihex_init_sink(ihex_ctx_t *ctx, ihex_data_fn on_data, ihex_eof_fn on_eof, void *user);
+
+//	Switch a freshly initialised context to sink mode, ihex_init_sink() without the ihex_init()
+	void ihex_set_sink(ihex_ctx_t *ctx, ihex_data_fn on_data, ihex_eof_fn on_eof, void *user);
+
+//	Initialise for a validate-only pre-scan. Every line is checked as usual, but data records are only noted in
+//	 manifest (which must be set up with ihex_manifest_init()), never surfaced: data_size stays 0 and parsing does
+//	 not stop until EOF or an error. A file that scans with ctx.eof set and no error has no format errors.
+	void ihex_init_scan(ihex_ctx_t *ctx, ihex_manifest_t *manifest);
+
+//	Switch a freshly initialised context to pre-scan, ihex_init_scan() without the ihex_init()
+	void ihex_set_scan(ihex_ctx_t *ctx, ihex_manifest_t *manifest);
+
+//	Clear a manifest. pages may be NULL, otherwise it holds (page_count+31)/32 words covering page_count pages of
+//	 page_size bytes from page_base.
+	void ihex_manifest_init(ihex_manifest_t *manifest, uint32_t *pages, uint32_t page_base, uint32_t page_size, uint32_t page_count);
+
+//	Only surface data inside windows (count of them, kept by the host), for flashing one region of a combined file.
+//	Records wholly outside are checked as usual and dropped: no ihex_proceed() stop, no sink call, no manifest entry.
+//	A record that straddles a window edge is clipped to the window. One that overlaps several windows surfaces once
+//	 per window (in address order, windows that overlap or touch count as one), each piece a record of its own:
+//	 ihex_proceed() brings the next piece, a sink is offered them in turn.
+//	Call after initialising, count 0 removes the filter.
+	void ihex_set_windows(ihex_ctx_t *ctx, const ihex_window_t *windows, int count);
+
 //	Attempt to pass src_len characters to the parser.
 //	The parser will accept characters up to and including LF (CR characters are ignored).
 //	The number of accepted characters is returned, or < 0 if an error has occurred.
@@ -59,9 +247,59 @@
 //	 and the return value will be 0 or < 0 if an error has occured.
 	int ihex_write(ihex_ctx_t *ctx, const char *src, int src_len);
 
+//	As ihex_write() over iovcnt spans taken in order, for instance the two halves of a wrapped DMA buffer.
+//	Lines may straddle spans. Returns the total number of characters accepted across all spans (stopping where
+//	 ihex_write() would), or < 0 if an error has occurred.
+	int ihex_writev(ihex_ctx_t *ctx, const ihex_iovec_t *iov, int iovcnt);
+
+//	As ihex_write(), for input already in memory (a whole file, or a large part of one).
+//	Complete lines are decoded directly from src without being copied into the context.
+//	Unlike ihex_write() it does not stop after each line, only where a data record is waiting for ihex_proceed(),
+//	 the sink is busy, EOF is reached, or an error occurs. A line cut off at the end of src is kept for the next call.
+	long ihex_parse_buffer(ihex_ctx_t *ctx, const char *src, long src_len);
+
 //	Provide a C string describing an IHEX_ERR_# code
 	const char* ihex_strerr(int err);
 
 //	Once a data record has been read, call this to continue parsing. 
 	void ihex_proceed(ihex_ctx_t *ctx);
+
+//	Recover from an error without starting over. The failing line (ctx.line_count, starting at input offset
+//	 ctx.line_offset) is thrown away along with anything received after it, and the error is cleared.
+//	The host then retransmits from the start of line resend_line, which may be the failing line itself or an earlier
+//	 one (for instance the start of a block). Lines ahead of the failing one are dropped unparsed, records already
+//	 delivered are not surfaced again. A resend_line beyond the failing line is treated as the failing line.
+	void ihex_retry(ihex_ctx_t *ctx, uint32_t resend_line);
+
+//	Offset into the input of the next character the parser expects, where a resumed transfer carries on.
+	uint32_t ihex_input_offset(const ihex_ctx_t *ctx);
+
+//	Save the parse position (extended linear address, input offset, line count and any partial line) to dst as a
+//	 versioned, checksummed blob of at most IHEX_CHECKPOINT_MAX bytes, for keeping in flash or EEPROM across a
+//	 power or link loss. Take it once the sink has durably stored every record delivered so far.
+//	Returns the blob size, IHEX_SINK_BUSY while a record is still pending, ctx.err if set, or IHEX_ERR_LEN if
+//	 dst_size is too small.
+	int ihex_checkpoint(const ihex_ctx_t *ctx, uint8_t *dst, int dst_size);
+
+//	Resume from a checkpoint. Initialise ctx for the transfer first (ihex_init_sink() etc.), the callbacks are kept.
+//	Then send the input from ihex_input_offset() onwards.
+//	Returns IHEX_OK, or IHEX_ERR_CHECKSUM for a damaged blob, IHEX_ERR_UNSUPPORTED_RECORD for another version
+//	 (or a partial line saved by a build with a different IHEX_STREAM_DECODE setting), IHEX_ERR_LEN if the partial
+//	 line does not fit. ctx is left unchanged on error.
+	int ihex_restore(ihex_ctx_t *ctx, const uint8_t *src, int src_len);
+
+#ifdef IHEX_SLOTS
+//	Initialise in slot mode. Each data record is moved into a free slot and parsing carries on with the next line,
+//	 while the host (or its DMA) is still using the records in the other slots. Once every slot is full the record
+//	 stays pending and ihex_write() stops, as with a busy sink, until ihex_slot_release() frees one.
+//	ihex_proceed() is not used.
+	void ihex_init_slots(ihex_ctx_t *ctx);
+
+//	Oldest data record not yet released, or NULL if there are none.
+//	It stays valid, and in place, while later records are parsed into the other slots.
+	ihex_slot_t* ihex_slot_front(ihex_ctx_t *ctx);
+
+//	The host (or its DMA) has finished with the record from ihex_slot_front(), its slot can be reused.
+	void ihex_slot_release(ihex_ctx_t *ctx);
+#endif
 #endif
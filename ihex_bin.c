@@ -0,0 +1,522 @@
+
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <pthread.h>
+
+	#include "ihex_bin.h"
+	#include "ihex_file.h"
+	#include "ihex_digest.h"
+
+	#if defined(__unix__) || defined(__APPLE__)
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <sys/mman.h>
+		#define HAVE_MMAP
+	#endif
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define MAX_THREADS		256
+	#define CRC_CHUNK		0x100000
+	#define SPARSE_RUN		0x10000		//	IHEX_BIN_SPARSE staging, contiguous records are written in runs of up to this
+
+//	Jobs [head, tail) still to be done by one thread, its owner takes from head and thieves from tail
+	typedef struct run_t
+	{
+		int head;
+		int tail;
+		pthread_mutex_t lock;
+	} run_t;
+
+	typedef struct pool_t
+	{
+		ihex_bin_job_t *jobs;
+		run_t *runs;
+		int threads;
+		uint8_t fill;
+		int output;
+	} pool_t;
+
+	typedef struct worker_t
+	{
+		pool_t *pool;
+		int index;
+	} worker_t;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int build_buffered(ihex_bin_t *bin, ihex_bin_job_t *job);
+#ifdef HAVE_MMAP
+	static int build_mmap(ihex_bin_t *bin, ihex_bin_job_t *job);
+	static int build_sparse(ihex_bin_t *bin, ihex_bin_job_t *job);
+	static int stage_record(void *user, uint32_t address, const uint8_t *data, int size);
+	static int flush_run(ihex_bin_t *bin);
+	static int pwrite_all(int fd, const uint8_t *data, size_t size, uint64_t offset);
+#endif
+	static int parse_into(ihex_bin_t *bin, ihex_bin_job_t *job, ihex_data_fn on_data);
+	static int place_record(void *user, uint32_t address, const uint8_t *data, int size);
+	static bool in_image(const ihex_bin_t *bin, uint32_t address, int size);
+	static int grow_buffer(ihex_bin_t *bin, uint64_t size);
+	static uint32_t crc32_of(const uint8_t *data, uint64_t size);
+	static int write_bin(const char *path, const uint8_t *data, uint64_t size);
+	static int write_manifest(const ihex_bin_job_t *job, uint8_t fill);
+	static void* worker(void *arg);
+	static int take_job(pool_t *pool, int self);
+	static run_t* fullest_run(pool_t *pool);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_bin_init(ihex_bin_t *bin, uint8_t fill, int output)
+{
+	memset(bin, 0, sizeof(*bin));
+	bin->fill = fill;
+	bin->output = output;
+	bin->fd = -1;
+}
+
+void ihex_bin_free(ihex_bin_t *bin)
+{
+	free(bin->buffer);
+	bin->buffer = NULL;
+	bin->buffer_size = 0;
+}
+
+int ihex_bin_convert(ihex_bin_t *bin, ihex_bin_job_t *job)
+{
+	int err;
+
+	job->base = 0;
+	job->size = 0;
+	job->crc32 = 0;
+
+	// validate and find the address range before anything is written
+	ihex_manifest_init(&bin->manifest, NULL, 0, 0, 0);
+	ihex_init_scan(&bin->ctx, &bin->manifest);
+	err = ihex_load_file(&bin->ctx, job->hex_path);
+	if(err == IHEX_OK && !bin->ctx.eof)
+		err = IHEX_ERR_EOF;
+
+	job->records = bin->manifest.records;
+	job->data_bytes = bin->manifest.data_bytes;
+	if(err == IHEX_OK && bin->manifest.data_bytes)
+	{
+		job->base = bin->manifest.min_address;
+		job->size = (uint64_t)bin->manifest.max_address - bin->manifest.min_address + 1;
+	};
+
+	if(err == IHEX_OK)
+	{
+		bin->base = job->base;
+		bin->size = job->size;
+#ifdef HAVE_MMAP
+		if(bin->output == IHEX_BIN_MMAP)
+			err = build_mmap(bin, job);
+		else if(bin->output == IHEX_BIN_SPARSE)
+			err = build_sparse(bin, job);
+		else
+#endif
+			err = build_buffered(bin, job);
+		if(err == IHEX_OK && job->manifest_path)
+			err = write_manifest(job, bin->fill);
+
+		// a .bin cut short (or sized but never filled in) must not pass for a converted file
+		if(err != IHEX_OK)
+		{
+			remove(job->bin_path);
+			if(job->manifest_path)
+				remove(job->manifest_path);
+		};
+	};
+
+	job->err = err;
+	return err;
+}
+
+int ihex_bin_batch(ihex_bin_job_t *jobs, int count, int threads, uint8_t fill, int output)
+{
+	pthread_t tid[MAX_THREADS];
+	worker_t workers[MAX_THREADS];
+	run_t runs[MAX_THREADS];
+	pool_t pool;
+	int started = 0;
+	int err = IHEX_OK;
+	int i;
+
+	if(threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	if(threads > count)
+		threads = count;
+	if(threads < 1)
+		threads = 1;
+
+	pool.jobs = jobs;
+	pool.runs = runs;
+	pool.threads = threads;
+	pool.fill = fill;
+	pool.output = output;
+	for(i=0; i < threads; i++)
+	{
+		runs[i].head = (int)((long long)count * i / threads);
+		runs[i].tail = (int)((long long)count * (i+1) / threads);
+		pthread_mutex_init(&runs[i].lock, NULL);
+		workers[i].pool = &pool;
+		workers[i].index = i;
+	};
+
+	// runs of threads that could not be started are left to be stolen
+	for(i=1; i < threads; i++)
+	{
+		if(pthread_create(&tid[started], NULL, worker, &workers[i]) == 0)
+			started++;
+	};
+	worker(&workers[0]);
+	for(i=0; i < started; i++)
+		pthread_join(tid[i], NULL);
+
+	for(i=0; i < threads; i++)
+		pthread_mutex_destroy(&runs[i].lock);
+
+	for(i=0; i < count && err == IHEX_OK; i++)
+		err = jobs[i].err;
+
+	return err;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int build_buffered(ihex_bin_t *bin, ihex_bin_job_t *job)
+{
+	int err = grow_buffer(bin, job->size);
+
+	if(err == IHEX_OK && job->size)
+	{
+		bin->image = bin->buffer;
+		memset(bin->image, bin->fill, job->size);
+		err = parse_into(bin, job, place_record);
+	};
+
+	if(err == IHEX_OK)
+	{
+		job->crc32 = crc32_of(bin->buffer, job->size);
+		err = write_bin(job->bin_path, bin->buffer, job->size);
+	};
+
+	return err;
+}
+
+#ifdef HAVE_MMAP
+
+//	The file is sized first, pages no record lands in are never touched unless they have to be filled
+static int build_mmap(ihex_bin_t *bin, ihex_bin_job_t *job)
+{
+	int err = IHEX_ERR_IO;
+	void *map;
+	int fd = open(job->bin_path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+
+	if(fd >= 0 && job->size <= SIZE_MAX && ftruncate(fd, (off_t)job->size) == 0)
+	{
+		if(job->size == 0)
+			err = IHEX_OK;
+		else if((map = mmap(NULL, (size_t)job->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED)
+		{
+			bin->image = map;
+			if(bin->fill)
+				memset(bin->image, bin->fill, (size_t)job->size);
+			err = parse_into(bin, job, place_record);
+			if(err == IHEX_OK)
+				job->crc32 = crc32_of(bin->image, job->size);
+			munmap(map, (size_t)job->size);
+		};
+	};
+
+	if(fd >= 0 && close(fd) != 0)
+		err = IHEX_ERR_IO;
+
+	return err;
+}
+
+//	As build_mmap(), but records are staged in the buffer and written with pwrite(), the file is only mapped to
+//	 read it back for the CRC
+static int build_sparse(ihex_bin_t *bin, ihex_bin_job_t *job)
+{
+	int err = grow_buffer(bin, SPARSE_RUN);
+	uint64_t pos;
+	size_t n;
+	void *map;
+
+	bin->fd = open(job->bin_path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if(bin->fd < 0 || ftruncate(bin->fd, (off_t)job->size) != 0)
+		err = IHEX_ERR_IO;
+
+	if(err == IHEX_OK && bin->fill)
+	{
+		memset(bin->buffer, bin->fill, SPARSE_RUN);
+		for(pos=0; pos < job->size && err == IHEX_OK; pos += n)
+		{
+			n = (job->size - pos < SPARSE_RUN) ? (size_t)(job->size - pos) : SPARSE_RUN;
+			err = pwrite_all(bin->fd, bin->buffer, n, pos);
+		};
+	};
+
+	if(err == IHEX_OK && job->size)
+	{
+		bin->run_size = 0;
+		err = parse_into(bin, job, stage_record);
+		if(err == IHEX_OK)
+			err = flush_run(bin);
+	};
+
+	if(err == IHEX_OK && job->size)
+	{
+		map = (job->size <= SIZE_MAX) ? mmap(NULL, (size_t)job->size, PROT_READ, MAP_SHARED, bin->fd, 0) : MAP_FAILED;
+		if(map == MAP_FAILED)
+			err = IHEX_ERR_IO;
+		else
+		{
+			job->crc32 = crc32_of(map, job->size);
+			munmap(map, (size_t)job->size);
+		};
+	};
+
+	if(bin->fd >= 0 && close(bin->fd) != 0)
+		err = IHEX_ERR_IO;
+	bin->fd = -1;
+
+	return err;
+}
+
+//	Records continuing the staged run are appended to it, anything else writes the run out first
+static int stage_record(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_bin_t *bin = user;
+	int err = IHEX_OK;
+
+	if(!in_image(bin, address, size))
+		err = IHEX_ERR_IO;
+	else if(bin->run_size && ((uint64_t)bin->run_address + bin->run_size != address || bin->run_size + size > bin->buffer_size))
+		err = flush_run(bin);
+
+	if(err == IHEX_OK)
+	{
+		if(bin->run_size == 0)
+			bin->run_address = address;
+		memcpy(&bin->buffer[bin->run_size], data, size);
+		bin->run_size += size;
+	};
+
+	return err;
+}
+
+static int flush_run(ihex_bin_t *bin)
+{
+	int err = pwrite_all(bin->fd, bin->buffer, bin->run_size, bin->run_address - bin->base);
+
+	bin->run_size = 0;
+	return err;
+}
+
+static int pwrite_all(int fd, const uint8_t *data, size_t size, uint64_t offset)
+{
+	ssize_t n = 0;
+
+	while(size && n >= 0)
+	{
+		n = pwrite(fd, data, size, (off_t)offset);
+		if(n > 0)
+		{
+			data += n;
+			size -= n;
+			offset += n;
+		}
+		else
+			n = -1;
+	};
+
+	return size ? IHEX_ERR_IO : IHEX_OK;
+}
+
+#endif
+
+static int parse_into(ihex_bin_t *bin, ihex_bin_job_t *job, ihex_data_fn on_data)
+{
+	ihex_init_sink(&bin->ctx, on_data, NULL, bin);
+	return ihex_load_file(&bin->ctx, job->hex_path);
+}
+
+static int place_record(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_bin_t *bin = user;
+	int err = IHEX_ERR_IO;
+
+	if(in_image(bin, address, size))
+	{
+		memcpy(&bin->image[address - bin->base], data, size);
+		err = IHEX_OK;
+	};
+
+	return err;
+}
+
+//	The image is sized by the pre-scan, a record outside it means the file changed before it was parsed again
+static bool in_image(const ihex_bin_t *bin, uint32_t address, int size)
+{
+	return address >= bin->base && (uint64_t)(address - bin->base) + (uint64_t)size <= bin->size;
+}
+
+//	The contents are not kept, so a larger buffer is allocated afresh rather than reallocated
+static int grow_buffer(ihex_bin_t *bin, uint64_t size)
+{
+	int err = IHEX_OK;
+
+	if(size > bin->buffer_size)
+	{
+		ihex_bin_free(bin);
+		if(size <= SIZE_MAX)
+			bin->buffer = malloc((size_t)size);
+		if(bin->buffer)
+			bin->buffer_size = (size_t)size;
+		else
+			err = IHEX_ERR_FULL;
+	};
+
+	return err;
+}
+
+static uint32_t crc32_of(const uint8_t *data, uint64_t size)
+{
+	ihex_digest_t d;
+	uint64_t pos;
+	uint64_t n;
+
+	ihex_digest_init(&d, IHEX_DIGEST_CRC32, IHEX_GAP_SKIP, 0, 0, 0);
+	for(pos=0; pos < size; pos += n)
+	{
+		n = (size - pos < CRC_CHUNK) ? size - pos : CRC_CHUNK;
+		ihex_digest_sink(&d, (uint32_t)pos, &data[pos], (int)n);
+	};
+	ihex_digest_eof(&d);
+
+	return d.crc32;
+}
+
+static int write_bin(const char *path, const uint8_t *data, uint64_t size)
+{
+	int err = IHEX_ERR_IO;
+	FILE *f = fopen(path, "wb");
+
+	if(f)
+	{
+		if(size == 0 || fwrite(data, 1, (size_t)size, f) == size)
+			err = IHEX_OK;
+		if(fclose(f) != 0)
+			err = IHEX_ERR_IO;
+	};
+
+	return err;
+}
+
+static int write_manifest(const ihex_bin_job_t *job, uint8_t fill)
+{
+	int err = IHEX_ERR_IO;
+	FILE *f = fopen(job->manifest_path, "w");
+
+	if(f)
+	{
+		fprintf(f, "hex %s\n", job->hex_path);
+		fprintf(f, "bin %s\n", job->bin_path);
+		fprintf(f, "base 0x%08lX\n", (unsigned long)job->base);
+		fprintf(f, "size %llu\n", (unsigned long long)job->size);
+		fprintf(f, "records %lu\n", (unsigned long)job->records);
+		fprintf(f, "data_bytes %lu\n", (unsigned long)job->data_bytes);
+		fprintf(f, "fill 0x%02X\n", fill);
+		fprintf(f, "crc32 0x%08lX\n", (unsigned long)job->crc32);
+		if(!ferror(f))
+			err = IHEX_OK;
+		if(fclose(f) != 0)
+			err = IHEX_ERR_IO;
+	};
+
+	return err;
+}
+
+static void* worker(void *arg)
+{
+	worker_t *w = arg;
+	ihex_bin_t bin;
+	int job;
+
+	ihex_bin_init(&bin, w->pool->fill, w->pool->output);
+	while((job = take_job(w->pool, w->index)) >= 0)
+		ihex_bin_convert(&bin, &w->pool->jobs[job]);
+	ihex_bin_free(&bin);
+
+	return NULL;
+}
+
+//	Next job from the thread's own run, or from the back half of the fullest run once its own is done.
+//	Returns -1 when every run is empty.
+static int take_job(pool_t *pool, int self)
+{
+	run_t *own = &pool->runs[self];
+	run_t *victim;
+	int job = -1;
+	int n;
+
+	pthread_mutex_lock(&own->lock);
+	if(own->head < own->tail)
+		job = own->head++;
+	pthread_mutex_unlock(&own->lock);
+
+	// the victim may have been emptied since it was picked, then look again
+	while(job < 0 && (victim = fullest_run(pool)) != NULL)
+	{
+		pthread_mutex_lock(&victim->lock);
+		n = (victim->tail - victim->head + 1) / 2;
+		victim->tail -= n;
+		job = (n > 0) ? victim->tail : -1;
+		pthread_mutex_unlock(&victim->lock);
+
+		if(n > 1)
+		{
+			pthread_mutex_lock(&own->lock);
+			own->head = job + 1;
+			own->tail = job + n;
+			pthread_mutex_unlock(&own->lock);
+		};
+	};
+
+	return job;
+}
+
+static run_t* fullest_run(pool_t *pool)
+{
+	run_t *fullest = NULL;
+	int most = 0;
+	int left, i;
+
+	for(i=0; i < pool->threads; i++)
+	{
+		pthread_mutex_lock(&pool->runs[i].lock);
+		left = pool->runs[i].tail - pool->runs[i].head;
+		pthread_mutex_unlock(&pool->runs[i].lock);
+		if(left > most)
+		{
+			most = left;
+			fullest = &pool->runs[i];
+		};
+	};
+
+	return fullest;
+}
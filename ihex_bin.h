@@ -0,0 +1,84 @@
+#ifndef _IHEX_BIN_H_
+#define _IHEX_BIN_H_
+
+	#include <stdint.h>
+	#include <stddef.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public defines
+//********************************************************************************************************
+
+//	How the .bin is written
+	#define IHEX_BIN_BUFFERED		0		//	built in the thread's buffer, then written in one go
+	#define IHEX_BIN_MMAP			1		//	records copied straight into the mapped .bin
+	#define IHEX_BIN_SPARSE			2		//	runs of contiguous records written at their offset with pwrite()
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	One hex file to convert, and what came of it
+	typedef struct ihex_bin_job_t
+	{
+//		Host use:
+		const char *hex_path;
+		const char *bin_path;
+		const char *manifest_path;	//	may be NULL
+		int err;				//	IHEX_OK once both outputs have been written
+		uint32_t base;			//	address of the first .bin byte
+		uint64_t size;			//	.bin length, from the lowest to the highest data byte
+		uint32_t records;		//	data records
+		uint32_t data_bytes;
+		uint32_t crc32;			//	of the .bin (as zlib)
+	} ihex_bin_job_t;
+
+//	Converter state for one thread. The parser context and the output buffer are kept from one file to the next,
+//	 the buffer only grows.
+	typedef struct ihex_bin_t
+	{
+//		Internal use:
+		uint8_t fill;
+		int output;				//	IHEX_BIN_#
+		uint8_t *buffer;
+		size_t buffer_size;
+		uint8_t *image;			//	.bin being built, the buffer or the mapped file
+		uint32_t base;			//	address of image[0]
+		uint64_t size;			//	bytes from base, records outside them are refused
+		int fd;					//	IHEX_BIN_SPARSE .bin
+		uint32_t run_address;	//	IHEX_BIN_SPARSE records staged in buffer, not yet written
+		uint32_t run_size;
+		ihex_ctx_t ctx;
+		ihex_manifest_t manifest;
+	} ihex_bin_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	Bytes of the .bin not covered by any record are set to fill, output is one of IHEX_BIN_#.
+//	IHEX_BIN_MMAP and IHEX_BIN_SPARSE size the .bin first, so with a fill of 0 the gaps are left as holes that take
+//	 no disk space or I/O (on file systems that support them) and read back as 0. Any other fill is written out.
+//	Both are POSIX only, elsewhere the output is buffered.
+	void ihex_bin_init(ihex_bin_t *bin, uint8_t fill, int output);
+
+//	Release the output buffer
+	void ihex_bin_free(ihex_bin_t *bin);
+
+//	Convert job->hex_path (host builds), filling in the rest of job.
+//	The file is pre-scanned first, so a file with a format error leaves no output behind. It is then parsed again
+//	 into job->bin_path as set by ihex_bin_init(), and described in job->manifest_path (text, one "key value"
+//	 per line). Records overlapping earlier ones overwrite them, as when programming.
+//	If either output cannot be written in full both are removed, so whatever the outcome there is no partial .bin.
+//	Returns job->err: IHEX_OK, the IHEX_ERR_# code of the first format error (IHEX_ERR_EOF if the EOF record
+//	 is missing), IHEX_ERR_IO if a file could not be read or written (or changed so that a record falls outside
+//	 the pre-scanned range), or IHEX_ERR_FULL if the buffer could not grow.
+	int ihex_bin_convert(ihex_bin_t *bin, ihex_bin_job_t *job);
+
+//	Convert count jobs on a work-stealing pool of threads (needs pthreads), each thread with its own ihex_bin_t.
+//	Jobs are dealt out in contiguous runs, a thread that runs dry takes half of what is left of the fullest run.
+//	Returns IHEX_OK if every job succeeded, otherwise the err of the first failed job in jobs order.
+	int ihex_bin_batch(ihex_bin_job_t *jobs, int count, int threads, uint8_t fill, int output);
+
+#endif
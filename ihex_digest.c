@@ -0,0 +1,390 @@
+
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdatomic.h>
+	#include <string.h>
+
+	#include "ihex_digest.h"
+
+	#if defined(IHEX_SIMD) && (defined(__x86_64__) || defined(__i386__))
+		#include <immintrin.h>
+		#include <cpuid.h>
+		#define HAVE_SHA_NI
+	#endif
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define CRC32_POLY			0xEDB88320		//	reflected 0x04C11DB7
+
+	#define ROR(x, n)			(((x) >> (n)) | ((x) << (32-(n))))
+	#define CH(x, y, z)			(((x) & (y)) ^ (~(x) & (z)))
+	#define MAJ(x, y, z)		(((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+	#define SIGMA0(x)			(ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+	#define SIGMA1(x)			(ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+	#define GAMMA0(x)			(ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+	#define GAMMA1(x)			(ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+	typedef void (*sha_blocks_fn_t)(uint32_t state[8], const uint8_t *data, int blocks);
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	Built by the first ihex_digest_init(), tables_state goes 0 (none) -> 1 (being built) -> 2 (ready)
+	static uint32_t crc_table[8][256];
+	static sha_blocks_fn_t sha_blocks;
+	static atomic_int tables_state;
+
+	static const uint32_t sha_k[64] =
+	{
+		0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+		0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+		0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+		0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+		0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+		0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+		0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+		0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+	};
+
+	static const uint32_t sha_init[8] =
+	{
+		0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+	};
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static void hash(ihex_digest_t *d, const uint8_t *data, uint32_t size);
+	static void hash_fill(ihex_digest_t *d, uint32_t size);
+	static void make_tables(void);
+	static void crc_make_tables(void);
+	static uint32_t crc_update(uint32_t crc, const uint8_t *p, uint32_t size);
+	static void sha_update(ihex_digest_t *d, const uint8_t *p, uint32_t size);
+	static void sha_final(ihex_digest_t *d);
+	static void sha_blocks_c(uint32_t state[8], const uint8_t *data, int blocks);
+	#ifdef HAVE_SHA_NI
+	static void sha_blocks_ni(uint32_t state[8], const uint8_t *data, int blocks);
+	#endif
+	static uint32_t load_be32(const uint8_t *p);
+	static uint32_t load_le32(const uint8_t *p);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_digest_init(ihex_digest_t *d, int algorithms, int gap_mode, uint8_t fill, uint32_t start, uint32_t end)
+{
+	memset(d, 0, sizeof(*d));
+	d->algorithms = algorithms;
+	d->gap_mode = gap_mode;
+	d->fill = fill;
+	d->end = end;
+	d->crc = 0xFFFFFFFF;
+	memcpy(d->sha_state, sha_init, sizeof(sha_init));
+
+	// with gap filling the image starts at start, whatever the first record
+	if(gap_mode == IHEX_GAP_FILL)
+	{
+		d->address = start;
+		d->started = true;
+	};
+
+	if(atomic_load_explicit(&tables_state, memory_order_acquire) != 2)
+		make_tables();
+}
+
+int ihex_digest_sink(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_digest_t *d = user;
+	int err = IHEX_OK;
+	uint32_t from = address;
+	uint32_t to = address + size;
+
+	if(d->started && address < d->address)
+		err = IHEX_ERR_OVERLAP;
+	else if(d->next)
+		err = d->next(d->next_user, address, data, size);
+
+	if(err == IHEX_OK)
+	{
+		// with gap filling only the part of the record below end is hashed
+		if(d->gap_mode == IHEX_GAP_FILL && d->end)
+		{
+			if(from > d->end)
+				from = d->end;
+			if(to > d->end)
+				to = d->end;
+		};
+		if(d->gap_mode == IHEX_GAP_FILL && from > d->address)
+			hash_fill(d, from - d->address);
+		if(to > from)
+			hash(d, data, to - from);
+		d->address = address + size;
+		d->started = true;
+	};
+
+	return err;
+}
+
+void ihex_digest_eof(void *user)
+{
+	ihex_digest_t *d = user;
+
+	if(d->gap_mode == IHEX_GAP_FILL && d->end > d->address)
+		hash_fill(d, d->end - d->address);
+
+	d->crc32 = ~d->crc;
+	if(d->algorithms & IHEX_DIGEST_SHA256)
+		sha_final(d);
+	d->done = true;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static void hash(ihex_digest_t *d, const uint8_t *data, uint32_t size)
+{
+	if(d->algorithms & IHEX_DIGEST_CRC32)
+		d->crc = crc_update(d->crc, data, size);
+	if(d->algorithms & IHEX_DIGEST_SHA256)
+		sha_update(d, data, size);
+	d->length += size;
+}
+
+static void hash_fill(ihex_digest_t *d, uint32_t size)
+{
+	uint8_t block[256];
+	uint32_t n;
+
+	memset(block, d->fill, (size < sizeof(block)) ? size:sizeof(block));
+	while(size)
+	{
+		n = (size < sizeof(block)) ? size:sizeof(block);
+		hash(d, block, n);
+		size -= n;
+	};
+}
+
+//	One caller builds the tables and picks the SHA-256 kernel, any others racing with it wait until it is done
+static void make_tables(void)
+{
+	int expected = 0;
+
+	if(atomic_compare_exchange_strong(&tables_state, &expected, 1))
+	{
+		crc_make_tables();
+		sha_blocks = sha_blocks_c;
+#ifdef HAVE_SHA_NI
+		unsigned a, b, c, x;
+		if(__get_cpuid_count(7, 0, &a, &b, &c, &x) && (b & (1u << 29)) && __builtin_cpu_supports("sse4.1"))
+			sha_blocks = sha_blocks_ni;
+#endif
+		atomic_store_explicit(&tables_state, 2, memory_order_release);
+	}
+	else
+	{
+		while(atomic_load_explicit(&tables_state, memory_order_acquire) != 2)
+			;
+	};
+}
+
+//	Slicing-by-8 tables: crc_table[k][i] is the CRC of byte i followed by k zero bytes
+static void crc_make_tables(void)
+{
+	uint32_t c;
+	int i, j, k;
+
+	for(i=0; i < 256; i++)
+	{
+		c = i;
+		for(j=0; j < 8; j++)
+			c = (c & 1) ? (c >> 1) ^ CRC32_POLY : (c >> 1);
+		crc_table[0][i] = c;
+	};
+
+	for(i=0; i < 256; i++)
+	{
+		for(k=1; k < 8; k++)
+			crc_table[k][i] = (crc_table[k-1][i] >> 8) ^ crc_table[0][crc_table[k-1][i] & 0xFF];
+	};
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *p, uint32_t size)
+{
+	uint32_t one, two;
+
+	// 8 bytes per step, one table lookup per byte and no dependency between them
+	while(size >= 8)
+	{
+		one = load_le32(p) ^ crc;
+		two = load_le32(p + 4);
+		crc = crc_table[7][one & 0xFF] ^ crc_table[6][(one >> 8) & 0xFF] ^
+			  crc_table[5][(one >> 16) & 0xFF] ^ crc_table[4][one >> 24] ^
+			  crc_table[3][two & 0xFF] ^ crc_table[2][(two >> 8) & 0xFF] ^
+			  crc_table[1][(two >> 16) & 0xFF] ^ crc_table[0][two >> 24];
+		p += 8;
+		size -= 8;
+	};
+
+	while(size--)
+		crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+
+	return crc;
+}
+
+static void sha_update(ihex_digest_t *d, const uint8_t *p, uint32_t size)
+{
+	uint32_t n;
+
+	// top up a partial block first, then whole blocks straight from p
+	if(d->sha_used)
+	{
+		n = 64 - d->sha_used;
+		if(n > size)
+			n = size;
+		memcpy(&d->sha_block[d->sha_used], p, n);
+		d->sha_used += n;
+		p += n;
+		size -= n;
+		if(d->sha_used == 64)
+		{
+			sha_blocks(d->sha_state, d->sha_block, 1);
+			d->sha_used = 0;
+		};
+	};
+
+	if(size >= 64)
+	{
+		sha_blocks(d->sha_state, p, size / 64);
+		p += size & ~63u;
+		size &= 63;
+	};
+
+	if(size)
+	{
+		memcpy(d->sha_block, p, size);
+		d->sha_used = size;
+	};
+}
+
+static void sha_final(ihex_digest_t *d)
+{
+	uint64_t bits = d->length * 8;
+	int i;
+
+	d->sha_block[d->sha_used++] = 0x80;
+	if(d->sha_used > 56)
+	{
+		memset(&d->sha_block[d->sha_used], 0, 64 - d->sha_used);
+		sha_blocks(d->sha_state, d->sha_block, 1);
+		d->sha_used = 0;
+	};
+	memset(&d->sha_block[d->sha_used], 0, 56 - d->sha_used);
+	for(i=0; i < 8; i++)
+		d->sha_block[56 + i] = (uint8_t)(bits >> (56 - 8*i));
+	sha_blocks(d->sha_state, d->sha_block, 1);
+
+	for(i=0; i < 32; i++)
+		d->sha256[i] = (uint8_t)(d->sha_state[i/4] >> (24 - 8*(i%4)));
+}
+
+static void sha_blocks_c(uint32_t state[8], const uint8_t *data, int blocks)
+{
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	while(blocks--)
+	{
+		for(i=0; i < 16; i++)
+			w[i] = load_be32(&data[4*i]);
+		for(; i < 64; i++)
+			w[i] = GAMMA1(w[i-2]) + w[i-7] + GAMMA0(w[i-15]) + w[i-16];
+
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+		for(i=0; i < 64; i++)
+		{
+			t1 = h + SIGMA1(e) + CH(e, f, g) + sha_k[i] + w[i];
+			t2 = SIGMA0(a) + MAJ(a, b, c);
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		};
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+		data += 64;
+	};
+}
+
+#ifdef HAVE_SHA_NI
+
+//	SHA extensions: two rounds per sha256rnds2, the state kept as ABEF/CDGH, the schedule with sha256msg1/msg2
+__attribute__((target("sha,sse4.1")))
+static void sha_blocks_ni(uint32_t state[8], const uint8_t *data, int blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+	__m128i abef, cdgh, abef_save, cdgh_save, tmp, msg, x;
+	__m128i w[4];
+	int j;
+
+	tmp = _mm_loadu_si128((const __m128i*)&state[0]);
+	cdgh = _mm_loadu_si128((const __m128i*)&state[4]);
+	tmp = _mm_shuffle_epi32(tmp, 0xB1);				// CDAB
+	cdgh = _mm_shuffle_epi32(cdgh, 0x1B);			// EFGH
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);			// ABEF
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);		// CDGH
+
+	while(blocks--)
+	{
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		for(j=0; j < 16; j++)
+		{
+			if(j < 4)
+				w[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&data[16*j]), bswap);
+			else
+			{
+				x = _mm_sha256msg1_epu32(w[(j-4) & 3], w[(j-3) & 3]);
+				x = _mm_add_epi32(x, _mm_alignr_epi8(w[(j-1) & 3], w[(j-2) & 3], 4));
+				w[j & 3] = _mm_sha256msg2_epu32(x, w[(j-1) & 3]);
+			};
+
+			msg = _mm_add_epi32(w[j & 3], _mm_loadu_si128((const __m128i*)&sha_k[4*j]));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0E);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh, msg);
+		};
+
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+		data += 64;
+	};
+
+	tmp = _mm_shuffle_epi32(abef, 0x1B);			// FEBA
+	cdgh = _mm_shuffle_epi32(cdgh, 0xB1);			// DCHG
+	abef = _mm_blend_epi16(tmp, cdgh, 0xF0);		// DCBA
+	cdgh = _mm_alignr_epi8(cdgh, tmp, 8);			// HGFE
+	_mm_storeu_si128((__m128i*)&state[0], abef);
+	_mm_storeu_si128((__m128i*)&state[4], cdgh);
+}
+
+#endif
+
+static uint32_t load_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t load_le32(const uint8_t *p)
+{
+	return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
@@ -0,0 +1,68 @@
+#ifndef _IHEX_DIGEST_H_
+#define _IHEX_DIGEST_H_
+
+	#include <stdint.h>
+	#include <stdbool.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public defines
+//********************************************************************************************************
+
+//	Algorithms, combine with |
+	#define IHEX_DIGEST_CRC32		0x01
+	#define IHEX_DIGEST_SHA256		0x02
+
+//	Gap handling
+	#define IHEX_GAP_SKIP			0		//	only the record bytes, concatenated in address order
+	#define IHEX_GAP_FILL			1		//	every byte from start, gaps hashed as the fill byte
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	Digest of the image, computed as records are parsed.
+//	Records must arrive in ascending address order, as they do from linker output. The result is that of hashing
+//	 the image read back from memory, so no read back pass is needed.
+	typedef struct ihex_digest_t
+	{
+//		Host use:
+		uint32_t crc32;			//	CRC-32 (IEEE 802.3, as zlib), valid once done
+		uint8_t sha256[32];		//	valid once done
+		bool done;				//	set by ihex_digest_eof()
+		uint64_t length;		//	bytes hashed
+		ihex_data_fn next;		//	optional sink records are passed on to (a record it refuses is not hashed)
+		void *next_user;
+//		Internal use:
+		int algorithms;
+		int gap_mode;
+		uint8_t fill;
+		uint32_t end;
+		uint32_t address;		//	next byte expected
+		bool started;
+		uint32_t crc;
+		uint32_t sha_state[8];
+		uint8_t sha_block[64];
+		int sha_used;
+	} ihex_digest_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	algorithms is a combination of IHEX_DIGEST_#.
+//	With IHEX_GAP_FILL the digest covers start up to end (exclusive, 0 for up to the last record), any byte not
+//	 in a record counts as fill. start and end are not used with IHEX_GAP_SKIP.
+//	The CRC-32 tables (8 KB) are built by the first call, calls racing with it from other threads wait for them.
+	void ihex_digest_init(ihex_digest_t *d, int algorithms, int gap_mode, uint8_t fill, uint32_t start, uint32_t end);
+
+//	Sink for ihex_init_sink() (pass the ihex_digest_t as user).
+//	With IHEX_GAP_FILL and an end, bytes of a record at or past end are passed on to next but not hashed.
+//	Returns IHEX_OK, IHEX_ERR_OVERLAP for a record below the previous one (or below start), or the result of next.
+	int ihex_digest_sink(void *d, uint32_t address, const uint8_t *data, int size);
+
+//	EOF handler for ihex_init_sink(), pads to end (IHEX_GAP_FILL) and finalises crc32 and sha256
+	void ihex_digest_eof(void *d);
+
+#endif
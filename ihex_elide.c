@@ -0,0 +1,122 @@
+
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "ihex_elide.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+//	Runs are measured a machine word at a time
+	typedef uintptr_t word_t;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int run_length(const uint8_t *data, int size, uint8_t value);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_elide_init(ihex_elide_t *el, uint8_t erased, int min_run, ihex_data_fn next, void *next_user)
+{
+	memset(el, 0, sizeof(*el));
+	el->erased = erased;
+	el->min_run = (min_run < 1) ? 1:min_run;
+	el->next = next;
+	el->next_user = next_user;
+}
+
+int ihex_elide_sink(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_elide_t *el = user;
+	const uint8_t *q;
+	int err = IHEX_OK;
+	int span = 0;			//	start of the bytes still to be passed on
+	int pos, run;
+
+	// carry on from the span next() refused
+	if(el->rec_done && address == el->rec_address)
+		span = el->rec_done;
+	// or from a run the previous record ended with, leading erased bytes that make it long enough are dropped
+	else if(el->run && address == el->run_end)
+	{
+		run = run_length(data, size, el->erased);
+		if(run && el->run >= el->min_run - run)
+		{
+			el->elided += run;
+			span = run;
+		};
+	};
+
+	// memchr() finds a candidate run, run_length() measures it
+	pos = span;
+	while(pos < size && err == IHEX_OK)
+	{
+		q = memchr(&data[pos], el->erased, size - pos);
+		if(!q)
+			break;
+		pos = q - data;
+		run = run_length(q, size - pos, el->erased);
+		if(run >= el->min_run)
+		{
+			if(pos > span)
+				err = el->next(el->next_user, address + span, &data[span], pos - span);
+			if(err == IHEX_OK)
+			{
+				el->elided += run;
+				span = pos + run;
+			};
+		};
+		pos += run;
+	};
+
+	if(err == IHEX_OK && span < size)
+		err = el->next(el->next_user, address + span, &data[span], size - span);
+
+	el->rec_address = address;
+	el->rec_done = (err == IHEX_OK) ? 0:span;
+
+	// the run this record ends with, for the next one to carry on
+	if(err == IHEX_OK)
+	{
+		run = 0;
+		while(run < size && data[size-1-run] == el->erased)
+			run++;
+		if(run == size && el->run && address == el->run_end)
+			run = (el->run >= el->min_run - run) ? el->min_run : el->run + run;
+		el->run = (run < el->min_run) ? run:el->min_run;
+		el->run_end = address + size;
+	};
+
+	return err;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	Number of leading bytes equal to value
+static int run_length(const uint8_t *data, int size, uint8_t value)
+{
+	word_t pattern, w;
+	int n = 0;
+
+	memset(&pattern, value, sizeof(pattern));
+	while(n + (int)sizeof(word_t) <= size)
+	{
+		memcpy(&w, &data[n], sizeof(w));
+		if(w != pattern)
+			break;
+		n += sizeof(word_t);
+	};
+
+	while(n < size && data[n] == value)
+		n++;
+
+	return n;
+}
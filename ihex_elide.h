@@ -0,0 +1,45 @@
+#ifndef _IHEX_ELIDE_H_
+#define _IHEX_ELIDE_H_
+
+	#include <stdint.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	Drops runs of the erased value (0xFF for most flash) from records on their way to the next stage, so already
+//	 erased bytes are not programmed. A record is split around each run of at least min_run erased bytes, shorter
+//	 runs are passed on inside the surrounding data to keep writes from fragmenting.
+//	A run at the start of a record that follows on from a run ending the previous record (at the next address) counts
+//	 from where that run started, so padding spread over records shorter than min_run is dropped too, once the bytes
+//	 already passed on reach min_run.
+	typedef struct ihex_elide_t
+	{
+//		Host use:
+		uint32_t elided;		//	bytes dropped so far
+//		Internal use:
+		uint8_t erased;
+		int min_run;
+		ihex_data_fn next;
+		void *next_user;
+		uint32_t rec_address;	//	record interrupted by a busy next(), and where the span it refused starts
+		int rec_done;
+		uint32_t run_end;		//	address after the last record taken
+		int run;				//	erased bytes that record ended with (counting those before it), up to min_run
+	} ihex_elide_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	min_run is the shortest run dropped (1 or more). next() follows the sink conventions of ihex.h.
+	void ihex_elide_init(ihex_elide_t *el, uint8_t erased, int min_run, ihex_data_fn next, void *next_user);
+
+//	Sink for ihex_init_sink() (pass the ihex_elide_t as user).
+//	Returns IHEX_OK once every span of the record has been taken, or the next() result if it was busy or failed.
+//	A record refused with IHEX_SINK_BUSY must be offered again unchanged, spans already taken are not passed twice.
+	int ihex_elide_sink(void *el, uint32_t address, const uint8_t *data, int size);
+
+#endif
@@ -0,0 +1,191 @@
+
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "ihex_enc.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define LINE_LEN(n, crlf)	(11 + 2*(n) + ((crlf) ? 2:1))
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+	static const char hex_digit[16] = "0123456789ABCDEF";
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int record_max(uint32_t address, int record_len);
+	static int emit_data(ihex_enc_t *enc, uint32_t address, const uint8_t *data, int size);
+	static int emit_line(ihex_enc_t *enc, uint8_t type, uint16_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+int ihex_enc_init(ihex_enc_t *enc, char *out, int out_size, int record_len)
+{
+	int err = IHEX_OK;
+
+	memset(enc, 0, sizeof(*enc));
+	enc->out = out;
+	enc->out_size = out_size;
+	enc->record_len = record_len;
+
+	// an 04 record must fit as well
+	if(record_len < 1 || record_len > 255 || out_size < LINE_LEN((record_len < 2) ? 2:record_len, true))
+		err = IHEX_ERR_LEN;
+
+	return err;
+}
+
+int ihex_enc_write(ihex_enc_t *enc, uint32_t address, const uint8_t *data, int size)
+{
+	bool full = false;
+	int done = 0;
+	uint32_t a;
+	int max, n;
+
+	while(done < size && !full)
+	{
+		a = address + done;
+
+		// the record being gathered ends when it is full or the data jumps elsewhere
+		if(enc->rec_size && (a != enc->rec_address + enc->rec_size || enc->rec_size == record_max(enc->rec_address, enc->record_len)))
+			full = (ihex_enc_flush(enc) != IHEX_OK);
+		else
+		{
+			max = record_max(enc->rec_size ? enc->rec_address : a, enc->record_len);
+			n = size - done;
+
+			if(!enc->rec_size && n >= max)
+			{
+				// whole record, encoded straight from data
+				if(emit_data(enc, a, &data[done], max) == IHEX_OK)
+					done += max;
+				else
+					full = true;
+			}
+			else
+			{
+				if(!enc->rec_size)
+					enc->rec_address = a;
+				max -= enc->rec_size;
+				if(n > max)
+					n = max;
+				memcpy(&enc->rec_data[enc->rec_size], &data[done], n);
+				enc->rec_size += n;
+				done += n;
+			};
+		};
+	};
+
+	return done;
+}
+
+int ihex_enc_flush(ihex_enc_t *enc)
+{
+	int err = IHEX_OK;
+
+	if(enc->rec_size)
+	{
+		err = emit_data(enc, enc->rec_address, enc->rec_data, enc->rec_size);
+		if(err == IHEX_OK)
+			enc->rec_size = 0;
+	};
+
+	return err;
+}
+
+int ihex_enc_eof(ihex_enc_t *enc)
+{
+	int err = ihex_enc_flush(enc);
+
+	if(err == IHEX_OK)
+		err = emit_line(enc, 0x01, 0, NULL, 0);
+
+	return err;
+}
+
+void ihex_enc_proceed(ihex_enc_t *enc)
+{
+	enc->out_len = 0;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	Data bytes a record starting at address may hold, records do not cross a 64K boundary
+static int record_max(uint32_t address, int record_len)
+{
+	uint32_t left = 0x10000 - (address & 0xFFFF);
+
+	return (left < (uint32_t)record_len) ? (int)left : record_len;
+}
+
+static int emit_data(ihex_enc_t *enc, uint32_t address, const uint8_t *data, int size)
+{
+	uint8_t ela[2] = {address >> 24, address >> 16};
+	int err = IHEX_OK;
+
+	if(!enc->ela_valid || (address >> 16) != enc->ext_lin_addr)
+	{
+		err = emit_line(enc, 0x04, 0, ela, 2);
+		if(err == IHEX_OK)
+		{
+			enc->ext_lin_addr = address >> 16;
+			enc->ela_valid = true;
+		};
+	};
+
+	if(err == IHEX_OK)
+		err = emit_line(enc, 0x00, address & 0xFFFF, data, size);
+
+	return err;
+}
+
+//	Encode one line, or return IHEX_SINK_BUSY if it does not fit
+static int emit_line(ihex_enc_t *enc, uint8_t type, uint16_t address, const uint8_t *data, int size)
+{
+	uint8_t head[4] = {size, address >> 8, address, type};
+	uint8_t checksum = 0;
+	char *dst = &enc->out[enc->out_len];
+	int err = IHEX_OK;
+	int i;
+
+	if(enc->out_len + LINE_LEN(size, enc->crlf) > enc->out_size)
+		err = IHEX_SINK_BUSY;
+	else
+	{
+		*dst++ = ':';
+		for(i=0; i < 4; i++)
+		{
+			*dst++ = hex_digit[head[i] >> 4];
+			*dst++ = hex_digit[head[i] & 0x0F];
+			checksum += head[i];
+		};
+		for(i=0; i < size; i++)
+		{
+			*dst++ = hex_digit[data[i] >> 4];
+			*dst++ = hex_digit[data[i] & 0x0F];
+			checksum += data[i];
+		};
+		checksum = -checksum;
+		*dst++ = hex_digit[checksum >> 4];
+		*dst++ = hex_digit[checksum & 0x0F];
+		if(enc->crlf)
+			*dst++ = '\r';
+		*dst++ = '\n';
+
+		enc->out_len = dst - enc->out;
+	};
+
+	return err;
+}
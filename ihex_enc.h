@@ -0,0 +1,64 @@
+#ifndef _IHEX_ENC_H_
+#define _IHEX_ENC_H_
+
+	#include <stdint.h>
+	#include <stdbool.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public defines
+//********************************************************************************************************
+
+//	Longest line the encoder produces: ':', 255 data bytes, CRLF
+	#define IHEX_ENC_LINE_MAX	(1 + 2*(4+255+1) + 2)
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	Streaming Intel HEX encoder, the counterpart of ihex_ctx_t.
+//	Data is gathered into records of record_len bytes, which are encoded as whole lines into a caller supplied
+//	 output buffer. A new record starts when the address is not contiguous or a 64K boundary is reached, and an 04
+//	 record is emitted whenever the upper 16 bits of the address change.
+	typedef struct ihex_enc_t
+	{
+//		Host use:
+		char *out;				//	encoded text, out_len characters of it are ready
+		int out_len;
+		bool crlf;				//	end lines with CRLF instead of LF
+//		Internal use:
+		int out_size;
+		int record_len;
+		uint32_t ext_lin_addr;
+		bool ela_valid;			//	ext_lin_addr has been emitted
+		uint32_t rec_address;	//	record being gathered
+		int rec_size;
+		uint8_t rec_data[255];
+	} ihex_enc_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	record_len is the data bytes per record (1..255, 16 or 32 are usual).
+//	out must hold at least one line of record_len bytes, IHEX_ENC_LINE_MAX always does.
+//	Returns IHEX_OK, or IHEX_ERR_LEN if either size is out of range.
+	int ihex_enc_init(ihex_enc_t *enc, char *out, int out_size, int record_len);
+
+//	Encode size bytes of data starting at address.
+//	Like ihex_write(), returns the number of bytes consumed, which is less than size once out is full.
+//	Send out_len characters from out, call ihex_enc_proceed() and write the rest.
+	int ihex_enc_write(ihex_enc_t *enc, uint32_t address, const uint8_t *data, int size);
+
+//	Encode the partial record being gathered, if any.
+//	Returns IHEX_OK, or IHEX_SINK_BUSY if out is full, drain it and call again.
+	int ihex_enc_flush(ihex_enc_t *enc);
+
+//	Flush, then encode the end of file record. Returns as ihex_enc_flush().
+	int ihex_enc_eof(ihex_enc_t *enc);
+
+//	The host has taken the out_len characters from out
+	void ihex_enc_proceed(ihex_enc_t *enc);
+
+#endif
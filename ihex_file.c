@@ -0,0 +1,105 @@
+
+
+	#include <stdio.h>
+	#include <stdlib.h>
+
+	#include "ihex_file.h"
+
+	#if defined(__unix__) || defined(__APPLE__)
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <sys/mman.h>
+		#include <sys/stat.h>
+		#define HAVE_MMAP
+	#endif
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define READ_CHUNK		0x10000
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+#ifdef HAVE_MMAP
+
+int ihex_load_file(ihex_ctx_t *ctx, const char *path)
+{
+	int err = IHEX_ERR_IO;
+	struct stat st;
+	void *map;
+	int fd = open(path, O_RDONLY);
+
+	if(fd >= 0 && fstat(fd, &st) == 0)
+	{
+		if(st.st_size == 0)
+			err = IHEX_OK;
+		else
+		{
+			map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(map != MAP_FAILED)
+			{
+				madvise(map, st.st_size, MADV_SEQUENTIAL);
+				err = ihex_parse_all(ctx, map, (long)st.st_size);
+				munmap(map, st.st_size);
+			};
+		};
+	};
+
+	if(fd >= 0)
+		close(fd);
+
+	return err;
+}
+
+#else
+
+//	Each call reads through its own buffer, so files can be loaded on several threads at once
+int ihex_load_file(ihex_ctx_t *ctx, const char *path)
+{
+	int err = IHEX_ERR_IO;
+	size_t n;
+	char *chunk = malloc(READ_CHUNK);
+	FILE *f = fopen(path, "rb");
+
+	if(!chunk)
+		err = IHEX_ERR_FULL;
+	else if(f)
+	{
+		err = IHEX_OK;
+		while(err == IHEX_OK && !ctx->eof && (n = fread(chunk, 1, READ_CHUNK, f)) > 0)
+			err = ihex_parse_all(ctx, chunk, (long)n);
+		if(ferror(f))
+			err = IHEX_ERR_IO;
+	};
+
+	if(f)
+		fclose(f);
+	free(chunk);
+
+	return err;
+}
+
+#endif
+
+int ihex_parse_all(ihex_ctx_t *ctx, const char *src, long src_len)
+{
+	int err = IHEX_OK;
+	long pos = 0;
+	long r;
+
+	while(err == IHEX_OK && pos < src_len && !ctx->eof)
+	{
+		r = ihex_parse_buffer(ctx, &src[pos], src_len - pos);
+		if(r < 0)
+			err = (int)r;
+		else if(r == 0 && !ctx->eof)
+			err = IHEX_SINK_BUSY;
+		else
+			pos += r;
+	};
+
+	return err;
+}
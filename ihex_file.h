@@ -0,0 +1,24 @@
+#ifndef _IHEX_FILE_H_
+#define _IHEX_FILE_H_
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	Parse a whole file with ihex_parse_buffer(). On POSIX hosts the file is memory mapped, so lines are decoded
+//	 straight from the page cache without staging copies.
+//	ctx should be initialised with ihex_init_sink(), records are delivered through its sink.
+//	Returns IHEX_OK once the file has been parsed (check ctx.eof for the EOF record), IHEX_ERR_IO if the file
+//	 could not be read, the latched IHEX_ERR_# code, or IHEX_SINK_BUSY if the sink stopped accepting records.
+//	Elsewhere the file is read in chunks through a buffer allocated per call (IHEX_ERR_FULL if it cannot be).
+//	Either way it may be called from several threads at once, each with its own ctx.
+	int ihex_load_file(ihex_ctx_t *ctx, const char *path);
+
+//	Run all of src (in memory) through ihex_parse_buffer(), as ihex_load_file() does with the file.
+//	Returns IHEX_OK once src has been taken or EOF reached, the latched IHEX_ERR_# code, or IHEX_SINK_BUSY if the
+//	 sink stopped accepting records.
+	int ihex_parse_all(ihex_ctx_t *ctx, const char *src, long src_len);
+
+#endif
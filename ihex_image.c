@@ -0,0 +1,138 @@
+
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "ihex_image.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define END(e)		((uint64_t)(e)->address + (e)->size)
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int upper_bound(const ihex_image_t *img, uint32_t address);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_image_init(ihex_image_t *img, ihex_extent_t *extents, int extent_max, uint8_t *pool, uint32_t pool_size)
+{
+	memset(img, 0, sizeof(*img));
+	img->extents = extents;
+	img->extent_max = extent_max;
+	img->pool = pool;
+	img->pool_size = pool_size;
+}
+
+int ihex_image_sink(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_image_t *img = user;
+	ihex_extent_t *prev = NULL;
+	ihex_extent_t *next = NULL;
+	uint64_t end = (uint64_t)address + size;
+	int err = IHEX_OK;
+	int i;
+
+	// records usually arrive in ascending order, check the last extent before searching
+	if(img->extent_count && img->extents[img->extent_count-1].address <= address)
+		i = img->extent_count;
+	else
+		i = upper_bound(img, address);
+
+	if(i > 0)
+		prev = &img->extents[i-1];
+	if(i < img->extent_count)
+		next = &img->extents[i];
+
+	if((prev && END(prev) > address) || (next && end > next->address) || end > 0x100000000ULL)
+		err = IHEX_ERR_OVERLAP;
+	else if(img->data_size + (uint32_t)size > img->pool_size)
+		err = IHEX_ERR_FULL;
+	else if(prev && END(prev) == address && prev->offset + prev->size == img->data_size)
+		prev->size += size;		// continues the extent at the end of the pool
+	else if(img->extent_count == img->extent_max)
+		err = IHEX_ERR_FULL;
+	else
+	{
+		memmove(&img->extents[i+1], &img->extents[i], (img->extent_count - i) * sizeof(ihex_extent_t));
+		img->extents[i].address = address;
+		img->extents[i].size = size;
+		img->extents[i].offset = img->data_size;
+		img->extent_count++;
+	};
+
+	if(!err)
+	{
+		memcpy(&img->pool[img->data_size], data, size);
+		img->data_size += size;
+	};
+
+	return err;
+}
+
+uint32_t ihex_image_read(const ihex_image_t *img, uint32_t address, uint8_t *dst, uint32_t len, uint8_t fill)
+{
+	const ihex_extent_t *e;
+	uint32_t held = 0;
+	uint32_t n, skip;
+	int i = ihex_image_find(img, address);
+
+	memset(dst, fill, len);
+
+	for(; i < img->extent_count && img->extents[i].address < (uint64_t)address + len; i++)
+	{
+		e = &img->extents[i];
+		skip = (e->address < address) ? address - e->address : 0;
+		n = e->size - skip;
+		if((uint64_t)e->address + skip + n > (uint64_t)address + len)
+			n = (uint32_t)((uint64_t)address + len - e->address - skip);
+		memcpy(&dst[e->address + skip - address], &img->pool[e->offset + skip], n);
+		held += n;
+	};
+
+	return held;
+}
+
+int ihex_image_find(const ihex_image_t *img, uint32_t address)
+{
+	int i = upper_bound(img, address);
+
+	if(i > 0 && END(&img->extents[i-1]) > address)
+		i--;
+
+	return i;
+}
+
+const uint8_t* ihex_image_data(const ihex_image_t *img, const ihex_extent_t *extent)
+{
+	return &img->pool[extent->offset];
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	Index of the first extent starting above address
+static int upper_bound(const ihex_image_t *img, uint32_t address)
+{
+	int lo = 0;
+	int hi = img->extent_count;
+	int mid;
+
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(img->extents[mid].address <= address)
+			lo = mid + 1;
+		else
+			hi = mid;
+	};
+
+	return lo;
+}
@@ -0,0 +1,57 @@
+#ifndef _IHEX_IMAGE_H_
+#define _IHEX_IMAGE_H_
+
+	#include <stdint.h>
+	#include <stdbool.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	A run of contiguous bytes held in the image
+	typedef struct ihex_extent_t
+	{
+		uint32_t address;
+		uint32_t size;
+		uint32_t offset;		//	of the data in the image pool
+	} ihex_extent_t;
+
+//	Sparse memory image built from data records, in caller supplied memory.
+//	Extents are kept sorted by address. A record continuing the most recently grown extent is appended to it,
+//	 so a typical file of ascending records becomes one extent per contiguous region, whatever the record size.
+	typedef struct ihex_image_t
+	{
+//		Host use:
+		ihex_extent_t *extents;	//	sorted by address, extent_count of them
+		int extent_count;
+		uint32_t data_size;		//	total bytes held
+//		Internal use:
+		int extent_max;
+		uint8_t *pool;
+		uint32_t pool_size;
+	} ihex_image_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	extents must hold extent_max entries, pool receives the record data (pool_size bytes).
+	void ihex_image_init(ihex_image_t *img, ihex_extent_t *extents, int extent_max, uint8_t *pool, uint32_t pool_size);
+
+//	Add a record. A sink for ihex_init_sink() (pass the ihex_image_t as user).
+//	Returns IHEX_OK, IHEX_ERR_OVERLAP if any of its bytes are already held, or IHEX_ERR_FULL if extents or pool ran out.
+	int ihex_image_sink(void *img, uint32_t address, const uint8_t *data, int size);
+
+//	Copy len bytes from address into dst, bytes not held are set to fill.
+//	Returns the number of bytes that were held. O(log n) in the number of extents.
+	uint32_t ihex_image_read(const ihex_image_t *img, uint32_t address, uint8_t *dst, uint32_t len, uint8_t fill);
+
+//	Index of the extent holding address, or of the first extent above it (extent_count if none).
+	int ihex_image_find(const ihex_image_t *img, uint32_t address);
+
+//	Data of an extent
+	const uint8_t* ihex_image_data(const ihex_image_t *img, const ihex_extent_t *extent);
+
+#endif
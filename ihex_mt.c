@@ -0,0 +1,371 @@
+
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <pthread.h>
+
+	#include "ihex_mt.h"
+	#include "ihex_file.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define PIECES_PER_THREAD	4
+	#define MAX_THREADS			256
+
+//	A decoded data record, address is only 16 bits (no ELA) unless based is set
+	typedef struct record_t
+	{
+		uint32_t address;
+		size_t offset;			//	into piece_t.payload
+		int size;
+		bool based;
+		uint32_t ext_lin_addr;	//	in force at the record, valid if based
+	#ifdef IHEX_FRAGMENT_SIZE
+		bool commit;			//	last fragment of its line
+	#endif
+		uint32_t line_count;	//	line position of the record's line in the piece, as in ihex_ctx_t
+		uint32_t line_offset;
+		uint32_t line_chars;	//	up to and including its LF
+	} record_t;
+
+	typedef struct piece_t
+	{
+		const char *src;
+		long len;
+		int line_max;			//	as the caller's context
+		record_t *records;
+		int record_count;
+		int record_max;
+		uint8_t *payload;
+		size_t payload_len;
+		size_t payload_max;
+		bool based;				//	the piece's first 04 record has been parsed
+		uint32_t last_ela;		//	valid if based
+		bool eof;
+		int err;
+		bool no_mem;
+		uint32_t line_count;	//	line position in the piece once parsed, as in ihex_ctx_t
+		uint32_t line_offset;
+		uint32_t line_chars;
+		const ihex_ctx_t *ctx;	//	while parsing
+	} piece_t;
+
+	typedef struct pool_t
+	{
+		piece_t *pieces;
+		int count;
+		int next;
+		pthread_mutex_t lock;
+	} pool_t;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static void* worker(void *arg);
+	static void parse_piece(piece_t *pc);
+	static int store_record(void *user, uint32_t address, const uint8_t *data, int size);
+	static const char* find_first_ela(const char *src, long len);
+	static int deliver(ihex_ctx_t *ctx, piece_t *pieces, int count);
+	static void add_lines(ihex_ctx_t *ctx, uint32_t line_count, uint32_t line_offset, uint32_t line_chars);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+int ihex_parse_parallel(ihex_ctx_t *ctx, const char *src, long src_len, int threads)
+{
+	pthread_t tid[MAX_THREADS];
+	pool_t pool;
+	piece_t *pieces = NULL;
+	long body_len = src_len;
+	long pos, end;
+	bool no_mem = false;
+	int count = 0;
+	int started = 0;
+	int err, i;
+
+	// only whole lines are parsed in parallel, a trailing partial line goes to ctx afterwards
+	while(body_len > 0 && src[body_len-1] != '\n')
+		body_len--;
+
+	if(threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	count = threads * PIECES_PER_THREAD;
+	if(count > body_len / IHEX_MT_MIN_CHUNK)
+		count = body_len / IHEX_MT_MIN_CHUNK;
+
+	// parallel parsing starts from a clean line with the records going to a sink, on contexts no larger than the pieces'
+	//	and with no resent lines to skip (see ihex_retry())
+	if(threads < 2 || count < 2 || !ctx->on_data || ctx->window_count || ctx->text_size || ctx->data_size || ctx->err || ctx->eof
+		|| ctx->line_max > IHEX_TEXT_LEN_MAX || ctx->skip_lines)
+		return ihex_parse_all(ctx, src, src_len);
+
+	pieces = calloc(count, sizeof(piece_t));
+	if(!pieces)
+		return ihex_parse_all(ctx, src, src_len);
+
+	for(i=0, pos=0; i < count; i++)
+	{
+		end = (i == count-1) ? body_len : (body_len / count) * (i+1);
+		while(end < body_len && src[end-1] != '\n')
+			end++;
+		if(end < pos)
+			end = pos;
+		pieces[i].src = &src[pos];
+		pieces[i].len = end - pos;
+		pieces[i].line_max = ctx->line_max;
+		pos = end;
+	};
+
+	pool.pieces = pieces;
+	pool.count = count;
+	pool.next = 0;
+	pthread_mutex_init(&pool.lock, NULL);
+
+	for(i=0; i < threads-1; i++)
+	{
+		if(pthread_create(&tid[started], NULL, worker, &pool) == 0)
+			started++;
+	};
+	worker(&pool);
+	for(i=0; i < started; i++)
+		pthread_join(tid[i], NULL);
+	pthread_mutex_destroy(&pool.lock);
+
+	for(i=0; i < count; i++)
+		no_mem |= pieces[i].no_mem;
+
+	if(no_mem)
+		err = ihex_parse_all(ctx, src, src_len);
+	else
+	{
+		err = deliver(ctx, pieces, count);
+		if(err == IHEX_OK && !ctx->eof)
+			err = ihex_parse_all(ctx, &src[body_len], src_len - body_len);
+	};
+
+	for(i=0; i < count; i++)
+	{
+		free(pieces[i].records);
+		free(pieces[i].payload);
+	};
+	free(pieces);
+
+	return err;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static void* worker(void *arg)
+{
+	pool_t *pool = arg;
+	int i;
+
+	do
+	{
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if(i < pool->count)
+			parse_piece(&pool->pieces[i]);
+	} while(i < pool->count);
+
+	return NULL;
+}
+
+//	The records before the piece's first 04 record are relative to an ELA not yet known,
+//	 they are parsed separately from the rest so they can be told apart.
+static void parse_piece(piece_t *pc)
+{
+	ihex_ctx_t ctx;
+	const char *ela = find_first_ela(pc->src, pc->len);
+	long split = ela ? ela - pc->src : pc->len;
+
+	ihex_init_sink(&ctx, store_record, NULL, pc);
+	ctx.line_max = pc->line_max;
+	pc->ctx = &ctx;
+	ihex_parse_buffer(&ctx, pc->src, split);
+	if(split < pc->len && ctx.err == IHEX_OK && !ctx.eof)
+	{
+		pc->based = true;
+		ihex_parse_buffer(&ctx, &pc->src[split], pc->len - split);
+		pc->last_ela = ctx.ext_lin_addr;
+	};
+
+	pc->err = ctx.err;
+	pc->eof = ctx.eof;
+	pc->line_count = ctx.line_count;
+	pc->line_offset = ctx.line_offset;
+	pc->line_chars = ctx.line_chars;
+	pc->ctx = NULL;
+}
+
+static int store_record(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	piece_t *pc = user;
+	record_t *records;
+	uint8_t *payload;
+	size_t max;
+
+	if(pc->record_count == pc->record_max)
+	{
+		max = pc->record_max ? pc->record_max*2 : 1024;
+		records = realloc(pc->records, max * sizeof(record_t));
+		if(records)
+		{
+			pc->records = records;
+			pc->record_max = max;
+		};
+	};
+
+	if(pc->payload_len + size > pc->payload_max)
+	{
+		max = pc->payload_max ? pc->payload_max*2 : (size_t)pc->len/2 + 256;
+		payload = realloc(pc->payload, max);
+		if(payload)
+		{
+			pc->payload = payload;
+			pc->payload_max = max;
+		};
+	};
+
+	if(pc->record_count == pc->record_max || pc->payload_len + size > pc->payload_max)
+		pc->no_mem = true;
+	else
+	{
+		pc->records[pc->record_count].address = address;
+		pc->records[pc->record_count].offset = pc->payload_len;
+		pc->records[pc->record_count].size = size;
+		pc->records[pc->record_count].based = pc->based;
+		pc->records[pc->record_count].ext_lin_addr = pc->ctx->ext_lin_addr;
+	#ifdef IHEX_FRAGMENT_SIZE
+		pc->records[pc->record_count].commit = pc->ctx->data_commit;
+	#endif
+		pc->records[pc->record_count].line_count = pc->ctx->line_count;
+		pc->records[pc->record_count].line_offset = pc->ctx->line_offset;
+		pc->records[pc->record_count].line_chars = pc->ctx->line_chars;
+		pc->record_count++;
+		memcpy(&pc->payload[pc->payload_len], data, size);
+		pc->payload_len += size;
+	};
+
+	return IHEX_OK;
+}
+
+//	Find the first line with record type 04, looking at the first 9 characters other than CR
+static const char* find_first_ela(const char *src, long len)
+{
+	const char *p = src;
+	const char *end = src + len;
+	const char *lf, *q;
+	const char *found = NULL;
+	char c[9];
+	int n;
+
+	while(!found && p < end)
+	{
+		lf = memchr(p, '\n', end - p);
+		if(!lf)
+			lf = end;
+
+		for(q=p, n=0; q < lf && n < 9; q++)
+		{
+			if(*q != '\r')
+				c[n++] = *q;
+		};
+
+		if(n == 9 && c[0] == ':' && c[7] == '0' && c[8] == '4')
+			found = p;
+		p = lf + 1;
+	};
+
+	return found;
+}
+
+//	Pass the records to the sink in file order, carrying the ELA and the line position from piece to piece,
+//	 then latch the state ctx would have after parsing the same lines.
+static int deliver(ihex_ctx_t *ctx, piece_t *pieces, int count)
+{
+	uint32_t base = ctx->ext_lin_addr;
+	bool stop = false;
+	int err = IHEX_OK;
+	uint32_t address;
+	record_t *rec;
+	int i, j, r;
+
+	for(i=0; i < count && !stop; i++)
+	{
+		for(j=0; j < pieces[i].record_count && !stop; j++)
+		{
+			rec = &pieces[i].records[j];
+			address = rec->based ? rec->address : (rec->address | base);
+			r = ctx->on_data(ctx->user, address, &pieces[i].payload[rec->offset], rec->size);
+			if(r != IHEX_OK)
+			{
+				stop = true;
+				err = r;
+				// the record is left pending, as ihex_parse_buffer() leaves it, with the ELA in force at its line
+				memcpy(ctx->data_buffer, &pieces[i].payload[rec->offset], rec->size);
+				ctx->data_address = address;
+				ctx->data_size = rec->size;
+			#ifdef IHEX_FRAGMENT_SIZE
+				ctx->data_commit = rec->commit;
+			#endif
+				if(rec->based)
+					base = rec->ext_lin_addr;
+				// a refused record's line has been taken, a failed one has not
+				if(r < 0)
+				{
+					ctx->err = r;
+					add_lines(ctx, rec->line_count, rec->line_offset, rec->line_chars);
+				}
+				else
+					add_lines(ctx, rec->line_count + 1, rec->line_offset + rec->line_chars, 0);
+			};
+		};
+
+		if(!stop)
+		{
+			add_lines(ctx, pieces[i].line_count, pieces[i].line_offset, pieces[i].line_chars);
+			if(pieces[i].based)
+				base = pieces[i].last_ela;
+
+			if(pieces[i].err)
+			{
+				stop = true;
+				err = ctx->err = pieces[i].err;
+			}
+			else if(pieces[i].eof)
+			{
+				stop = true;
+				ctx->eof = true;
+				if(ctx->on_eof)
+					ctx->on_eof(ctx->user);
+			};
+		};
+	};
+
+	ctx->ext_lin_addr = base;
+	return err;
+}
+
+//	Move ctx on by a line position counted from the start of a piece, which begins where ctx is
+static void add_lines(ihex_ctx_t *ctx, uint32_t line_count, uint32_t line_offset, uint32_t line_chars)
+{
+	// blank lines ahead of the piece's first line are part of it
+	if(line_count)
+	{
+		ctx->line_offset += ctx->line_chars + line_offset;
+		ctx->line_chars = 0;
+	};
+	ctx->line_count += line_count;
+	ctx->line_chars += line_chars;
+}
@@ -0,0 +1,33 @@
+#ifndef _IHEX_MT_H_
+#define _IHEX_MT_H_
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public defines
+//********************************************************************************************************
+
+//	Inputs smaller than this per thread are parsed sequentially
+	#ifndef IHEX_MT_MIN_CHUNK
+		#define IHEX_MT_MIN_CHUNK	0x10000
+	#endif
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	Parse an in-memory hex file on a pool of threads (host builds, needs pthreads).
+//	src is split at line boundaries and the pieces are decoded in parallel. Each piece starts without knowing the
+//	 extended linear address in force, a prefix scan over the last 04 record of the preceding pieces fixes up the
+//	 addresses of the records ahead of its own first 04 record.
+//	Records are then passed to the sink of ctx (see ihex_init_sink()) on the calling thread, in file order.
+//	The outcome is the same as ihex_parse_buffer() over all of src: the same records, the same first error in file
+//	 order and line position (ctx.line_count, ctx.line_offset), nothing after the EOF record, and a line cut off at
+//	 the end of src is left in ctx. A record the sink refuses or fails is left pending in ctx (ctx.data_size) with
+//	 the extended linear address in force at its line, so parsing can carry on from ihex_input_offset().
+//	With address windows set (ihex_set_windows()), or lines to skip after ihex_retry(), src is parsed sequentially.
+//	Returns IHEX_OK once src has been parsed, the latched IHEX_ERR_# code, or IHEX_SINK_BUSY if the sink stopped
+//	 accepting records.
+	int ihex_parse_parallel(ihex_ctx_t *ctx, const char *src, long src_len, int threads);
+
+#endif
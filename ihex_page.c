@@ -0,0 +1,108 @@
+
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "ihex_page.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int emit_page(ihex_page_t *pg);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_page_init(ihex_page_t *pg, uint8_t *buffer, int page_size, uint8_t fill, ihex_data_fn on_page, void *user)
+{
+	memset(pg, 0, sizeof(*pg));
+	pg->buffer = buffer;
+	pg->page_size = page_size;
+	pg->fill = fill;
+	pg->on_page = on_page;
+	pg->user = user;
+}
+
+int ihex_page_sink(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_page_t *pg = user;
+	uint32_t page_mask = ~(uint32_t)(pg->page_size-1);
+	uint32_t rec_address = address;
+	int done = 0;
+	int err = IHEX_OK;
+	int offset, n;
+
+	// skip whatever was taken before on_page() went busy
+	if(pg->rec_done && address == pg->rec_address)
+		done = pg->rec_done;
+
+	// used only counts the bytes of a page once if nothing is written to it twice
+	if(rec_address + done < pg->next)
+		err = IHEX_ERR_OVERLAP;
+
+	// a full page may still be waiting for on_page()
+	if(!err && pg->open && pg->used >= pg->page_size)
+		err = emit_page(pg);
+
+	while(done < size && err == IHEX_OK)
+	{
+		address = rec_address + done;
+
+		if(pg->open && (address & page_mask) != pg->address)
+			err = emit_page(pg);
+
+		if(!err)
+		{
+			if(!pg->open)
+			{
+				memset(pg->buffer, pg->fill, pg->page_size);
+				pg->address = address & page_mask;
+				pg->used = 0;
+				pg->open = true;
+			};
+
+			offset = address - pg->address;
+			n = size - done;
+			if(n > pg->page_size - offset)
+				n = pg->page_size - offset;
+
+			memcpy(&pg->buffer[offset], &data[done], n);
+			pg->used += n;
+			done += n;
+			pg->next = address + n;
+
+			if(pg->used >= pg->page_size)
+				err = emit_page(pg);
+		};
+	};
+
+	pg->rec_address = rec_address;
+	pg->rec_done = (err == IHEX_OK) ? 0:done;
+
+	return err;
+}
+
+int ihex_page_flush(ihex_page_t *pg)
+{
+	return pg->open ? emit_page(pg):IHEX_OK;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int emit_page(ihex_page_t *pg)
+{
+	int err = pg->on_page(pg->user, pg->address, pg->buffer, pg->page_size);
+
+	if(err == IHEX_OK)
+		pg->open = false;
+
+	return err;
+}
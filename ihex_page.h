@@ -0,0 +1,53 @@
+#ifndef _IHEX_PAGE_H_
+#define _IHEX_PAGE_H_
+
+	#include <stdint.h>
+	#include <stdbool.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	Coalesces data records into page aligned blocks for flash programming.
+//	Records are copied into a caller supplied page buffer (pre-filled with the fill byte) until either every byte
+//	 of the page has been written, or a record lands in a different page. The page is then passed to on_page()
+//	 as one block of page_size bytes at a page aligned address.
+//	Records must come in ascending address order without overlapping (put ihex_reorder_t ahead if they do not):
+//	 a page is only written once, so a record going back into it would reach flash as a page of fill bytes.
+	typedef struct ihex_page_t
+	{
+//		Internal use:
+		uint8_t *buffer;
+		int page_size;
+		uint8_t fill;
+		ihex_data_fn on_page;
+		void *user;
+		bool open;				//	buffer holds the page at address
+		uint32_t address;
+		int used;				//	bytes written to the open page
+		uint32_t next;			//	address after the last byte taken
+		uint32_t rec_address;	//	record interrupted by a busy on_page(), and how much of it was already taken
+		int rec_done;
+	} ihex_page_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	page_size must be a power of 2, buffer must hold page_size bytes.
+//	on_page() follows the sink conventions of ihex.h, it may return IHEX_SINK_BUSY.
+	void ihex_page_init(ihex_page_t *pg, uint8_t *buffer, int page_size, uint8_t fill, ihex_data_fn on_page, void *user);
+
+//	Sink for ihex_init_sink() (pass the ihex_page_t as user), or call it directly with ctx.data_address/data_buffer/data_size.
+//	Returns IHEX_OK when the record has been taken, the on_page() result if it was busy or failed, or IHEX_ERR_OVERLAP
+//	 (nothing taken) if the record starts below the end of the previous one.
+//	A record refused with IHEX_SINK_BUSY must be offered again unchanged, parts already taken are not copied twice.
+	int ihex_page_sink(void *pg, uint32_t address, const uint8_t *data, int size);
+
+//	Pass on the partially filled page, if any. Call once the end of file has been reached.
+//	Returns IHEX_OK, or the on_page() result.
+	int ihex_page_flush(ihex_page_t *pg);
+
+#endif
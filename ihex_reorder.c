@@ -0,0 +1,139 @@
+
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "ihex_reorder.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int emit(ihex_reorder_t *ro, uint32_t address, const uint8_t *data, int size);
+	static int emit_lowest(ihex_reorder_t *ro);
+	static void hold(ihex_reorder_t *ro, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_reorder_init(ihex_reorder_t *ro, ihex_reorder_slot_t *slots, int window, uint8_t *pool, int slot_size,
+	ihex_data_fn next, void *next_user)
+{
+	int i;
+
+	memset(ro, 0, sizeof(*ro));
+	ro->slots = slots;
+	ro->window = window;
+	ro->slot_size = slot_size;
+	ro->next = next;
+	ro->next_user = next_user;
+
+	// the pool is carved into fixed blocks once, slots [count..window-1] own the free ones
+	for(i=0; i < window; i++)
+		slots[i].data = &pool[i * slot_size];
+}
+
+int ihex_reorder_sink(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	ihex_reorder_t *ro = user;
+	int err = IHEX_OK;
+	bool sent = false;
+
+	if((ro->emitted && address < ro->out_end) || size > ro->slot_size)
+	{
+		// can not be put in order, held records below it go first
+		while(err == IHEX_OK && ro->count && ro->slots[ro->count-1].address < address)
+			err = emit_lowest(ro);
+		if(err == IHEX_OK)
+			err = emit(ro, address, data, size);
+		if(err == IHEX_OK)
+			ro->passed++;
+		sent = true;
+	}
+	else if(ro->count == ro->window)
+	{
+		// window full, whichever is lowest goes on
+		if(ro->count == 0 || address < ro->slots[ro->count-1].address)
+		{
+			err = emit(ro, address, data, size);
+			sent = true;
+		}
+		else
+			err = emit_lowest(ro);
+	};
+
+	if(err == IHEX_OK)
+	{
+		if(!sent)
+			hold(ro, address, data, size);
+		if(ro->records == 0 || address >= ro->in_end)
+			ro->in_order++;
+		ro->records++;
+		ro->in_end = address + size;
+	};
+
+	return err;
+}
+
+int ihex_reorder_flush(ihex_reorder_t *ro)
+{
+	int err = IHEX_OK;
+
+	while(err == IHEX_OK && ro->count)
+		err = emit_lowest(ro);
+
+	return err;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int emit(ihex_reorder_t *ro, uint32_t address, const uint8_t *data, int size)
+{
+	int err = ro->next(ro->next_user, address, data, size);
+
+	if(err == IHEX_OK)
+	{
+		ro->emitted = true;
+		ro->out_end = address + size;
+	};
+
+	return err;
+}
+
+//	The lowest record is last, once passed on its block joins the free ones after it
+static int emit_lowest(ihex_reorder_t *ro)
+{
+	ihex_reorder_slot_t *s = &ro->slots[ro->count-1];
+	int err = emit(ro, s->address, s->data, s->size);
+
+	if(err == IHEX_OK)
+		ro->count--;
+
+	return err;
+}
+
+//	Insertion into the sorted slots, the window is small
+static void hold(ihex_reorder_t *ro, uint32_t address, const uint8_t *data, int size)
+{
+	uint8_t *block = ro->slots[ro->count].data;
+	int i = ro->count;
+
+	while(i > 0 && ro->slots[i-1].address <= address)
+	{
+		ro->slots[i] = ro->slots[i-1];
+		i--;
+	};
+
+	ro->slots[i].address = address;
+	ro->slots[i].size = size;
+	ro->slots[i].data = block;
+	memcpy(block, data, size);
+	ro->count++;
+}
@@ -0,0 +1,61 @@
+#ifndef _IHEX_REORDER_H_
+#define _IHEX_REORDER_H_
+
+	#include <stdint.h>
+	#include <stdbool.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	One held record, the host supplies window of them
+	typedef struct ihex_reorder_slot_t
+	{
+		uint32_t address;
+		int size;
+		uint8_t *data;			//	slot_size bytes of the pool
+	} ihex_reorder_slot_t;
+
+//	Puts records back into address order before the next stage, for toolchains that emit sections interleaved or
+//	 the vector table last. Up to window records are held, each copied into a fixed slot_size block of a caller
+//	 supplied pool, and passed on lowest address first as room is needed (or by ihex_reorder_flush()).
+//	A record that arrives below what has already been passed on, or that is larger than a slot, is passed straight
+//	 through after any held records below it, so output is never lost, only less ordered.
+	typedef struct ihex_reorder_t
+	{
+//		Host use:
+		uint32_t records;		//	records taken
+		uint32_t in_order;		//	of which began at or after the end of the one before (input already monotonic)
+		uint32_t passed;		//	records passed straight through, out of order
+//		Internal use:
+		ihex_reorder_slot_t *slots;		//	held records from [0] highest address down to [count-1] lowest
+		int window;
+		int count;
+		int slot_size;
+		ihex_data_fn next;
+		void *next_user;
+		bool emitted;
+		uint32_t out_end;		//	end of the last record passed on
+		uint32_t in_end;		//	end of the last record taken
+	} ihex_reorder_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	slots holds window entries, pool window*slot_size bytes. next() follows the sink conventions of ihex.h.
+	void ihex_reorder_init(ihex_reorder_t *ro, ihex_reorder_slot_t *slots, int window, uint8_t *pool, int slot_size,
+		ihex_data_fn next, void *next_user);
+
+//	Sink for ihex_init_sink() (pass the ihex_reorder_t as user).
+//	Returns IHEX_OK once the record has been taken (held or passed on), or the next() result if it was busy or failed.
+//	A record refused with IHEX_SINK_BUSY must be offered again unchanged.
+	int ihex_reorder_sink(void *ro, uint32_t address, const uint8_t *data, int size);
+
+//	Pass on every held record in address order. Call once the end of file has been reached.
+//	Returns IHEX_OK, or the next() result (call again after IHEX_SINK_BUSY).
+	int ihex_reorder_flush(ihex_reorder_t *ro);
+
+#endif
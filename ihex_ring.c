@@ -0,0 +1,63 @@
+
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "ihex_ring.h"
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+void ihex_ring_init(ihex_ring_t *ring, char *buffer, uint32_t size)
+{
+	ring->buffer = buffer;
+	ring->mask = size - 1;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->overruns, 0);
+}
+
+bool ihex_ring_push(ihex_ring_t *ring, char c)
+{
+	unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	bool pushed = (head - tail <= ring->mask);
+
+	if(pushed)
+	{
+		ring->buffer[head & ring->mask] = c;
+		atomic_store_explicit(&ring->head, head + 1, memory_order_release);		// publishes the byte
+	}
+	else
+		atomic_store_explicit(&ring->overruns, atomic_load_explicit(&ring->overruns, memory_order_relaxed) + 1, memory_order_relaxed);
+
+	return pushed;
+}
+
+int ihex_ring_drain(ihex_ring_t *ring, ihex_ctx_t *ctx)
+{
+	unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uint32_t offset = tail & ring->mask;
+	uint32_t queued = head - tail;
+	ihex_iovec_t iov[2];
+	int r;
+
+	// up to the end of the buffer, then the wrapped part
+	iov[0].base = &ring->buffer[offset];
+	iov[0].len = (queued > ring->mask + 1 - offset) ? ring->mask + 1 - offset : queued;
+	iov[1].base = ring->buffer;
+	iov[1].len = queued - iov[0].len;
+
+	r = ihex_writev(ctx, iov, 2);
+	if(r > 0)
+		atomic_store_explicit(&ring->tail, tail + r, memory_order_release);		// hands the space back
+
+	return r;
+}
+
+uint32_t ihex_ring_count(ihex_ring_t *ring)
+{
+	return atomic_load_explicit(&ring->head, memory_order_acquire) - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
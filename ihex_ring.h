@@ -0,0 +1,45 @@
+#ifndef _IHEX_RING_H_
+#define _IHEX_RING_H_
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdatomic.h>
+
+	#include "ihex.h"
+
+//********************************************************************************************************
+// Public variables
+//********************************************************************************************************
+
+//	Single producer, single consumer byte ring between a receive ISR and the parser.
+//	head and tail run freely and are masked on use, each is written by one side only, so plain C11 atomic loads and
+//	 stores are enough: no locks, no read-modify-write, nothing a Cortex-M0 can not do on a 32 bit word.
+	typedef struct ihex_ring_t
+	{
+		char *buffer;
+		uint32_t mask;			//	size-1
+		atomic_uint head;		//	written by the producer
+		atomic_uint tail;		//	written by the consumer
+		atomic_uint overruns;	//	bytes dropped because the ring was full, written by the producer
+	} ihex_ring_t;
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	size must be a power of 2 (up to 2^31), buffer must hold size bytes.
+	void ihex_ring_init(ihex_ring_t *ring, char *buffer, uint32_t size);
+
+//	Producer side (the ISR). Returns false, and counts an overrun, if the ring is full.
+//	Constant time: two atomic loads, the byte store and one atomic store (release), with one branch.
+	bool ihex_ring_push(ihex_ring_t *ring, char c);
+
+//	Consumer side. Feeds the bytes in the ring to ihex_writev() in place, as up to two contiguous spans.
+//	Stops where ihex_write() does (a data record is ready, a busy sink, EOF), bytes it did not accept stay queued.
+//	Returns the number of bytes passed to the parser, or the latched IHEX_ERR_# code.
+	int ihex_ring_drain(ihex_ring_t *ring, ihex_ctx_t *ctx);
+
+//	Bytes queued, from either side
+	uint32_t ihex_ring_count(ihex_ring_t *ring);
+
+#endif
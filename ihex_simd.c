@@ -0,0 +1,258 @@
+
+#ifdef IHEX_SIMD
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdatomic.h>
+
+	#include "ihex.h"
+	#include "ihex_simd.h"
+
+	#if defined(__x86_64__) || defined(__i386__)
+		#include <immintrin.h>
+		#define HAVE_X86
+	#elif defined(__ARM_NEON) && defined(__aarch64__)
+		#include <arm_neon.h>
+		#define HAVE_NEON
+	#endif
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	typedef int (*decode_fn_t)(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad);
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int best_level(void);
+	static decode_fn_t kernel_for(int level);
+
+	#ifdef HAVE_X86
+	static int decode_sse2(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad);
+	static int decode_avx2(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad);
+	#endif
+
+	#ifdef HAVE_NEON
+	static int decode_neon(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad);
+	#endif
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	ihex_mt threads decode concurrently, so the selection is atomic. kernel is stored before level (release),
+//	 racing first uses all pick the same best kernel.
+	static atomic_int level = -1;
+	static _Atomic(decode_fn_t) kernel;
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+int ihex_simd_decode(uint8_t *dst, const char *src, int byte_count, uint8_t *checksum)
+{
+	uint32_t sum = 0;
+	bool bad = false;
+	int done = 0;
+	decode_fn_t k;
+
+	if(atomic_load_explicit(&level, memory_order_acquire) < 0)
+		ihex_simd_force(best_level());
+
+	k = atomic_load_explicit(&kernel, memory_order_relaxed);
+	if(k)
+		done = k(dst, src, byte_count, &sum, &bad);
+
+	*checksum += (uint8_t)sum;
+
+	return bad ? IHEX_ERR_HEX:done;
+}
+
+int ihex_simd_level(void)
+{
+	if(atomic_load_explicit(&level, memory_order_acquire) < 0)
+		ihex_simd_force(best_level());
+	return atomic_load_explicit(&level, memory_order_relaxed);
+}
+
+int ihex_simd_force(int new_level)
+{
+	int best = best_level();
+
+	if(new_level < 0 || new_level > best || (new_level != IHEX_SIMD_NONE && kernel_for(new_level) == 0))
+		new_level = best;
+
+	atomic_store_explicit(&kernel, kernel_for(new_level), memory_order_relaxed);
+	atomic_store_explicit(&level, new_level, memory_order_release);
+	return new_level;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int best_level(void)
+{
+	int retval = IHEX_SIMD_NONE;
+#if defined(HAVE_X86)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		retval = IHEX_SIMD_AVX2;
+	else if(__builtin_cpu_supports("sse2"))
+		retval = IHEX_SIMD_SSE2;
+#elif defined(HAVE_NEON)
+	retval = IHEX_SIMD_NEON;
+#endif
+	return retval;
+}
+
+static decode_fn_t kernel_for(int level)
+{
+	decode_fn_t fn = 0;
+	switch(level)
+	{
+#ifdef HAVE_X86
+		case IHEX_SIMD_SSE2: fn = decode_sse2; break;
+		case IHEX_SIMD_AVX2: fn = decode_avx2; break;
+#endif
+#ifdef HAVE_NEON
+		case IHEX_SIMD_NEON: fn = decode_neon; break;
+#endif
+		default: break;
+	};
+	return fn;
+}
+
+#ifdef HAVE_X86
+
+//	16 characters -> 8 bytes per iteration.
+//	Each character is classified as a digit (c-'0' <= 9) or a letter ((c|0x20)-'a' <= 5) using unsigned min/compare,
+//	 anything else sets bits in the error accumulator which is only inspected once at the end.
+__attribute__((target("sse2")))
+static int decode_sse2(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad)
+{
+	const __m128i ch_0 = _mm_set1_epi8('0');
+	const __m128i ch_a = _mm_set1_epi8('a');
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i five = _mm_set1_epi8(5);
+	const __m128i ten = _mm_set1_epi8(10);
+	const __m128i low_byte = _mm_set1_epi16(0x00FF);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi8(-1);
+	__m128i err = zero;
+	__m128i acc = zero;
+	__m128i c, d, a, is_d, is_a, v, b;
+	int done = 0;
+
+	while(byte_count - done >= 8)
+	{
+		c = _mm_loadu_si128((const __m128i*)&src[2*done]);
+
+		d = _mm_sub_epi8(c, ch_0);
+		is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+		a = _mm_sub_epi8(_mm_or_si128(c, case_bit), ch_a);
+		is_a = _mm_cmpeq_epi8(_mm_min_epu8(a, five), a);
+		err = _mm_or_si128(err, _mm_andnot_si128(_mm_or_si128(is_d, is_a), ones));
+		v = _mm_or_si128(_mm_and_si128(is_d, d), _mm_and_si128(is_a, _mm_add_epi8(a, ten)));
+
+		// each 16 bit lane holds {high nibble, low nibble}, fold to one byte per lane
+		b = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, low_byte), 4), _mm_srli_epi16(v, 8));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(b, zero));
+		_mm_storel_epi64((__m128i*)&dst[done], _mm_packus_epi16(b, b));
+		done += 8;
+	};
+
+	*sum += (uint32_t)_mm_cvtsi128_si32(acc) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+	*bad |= _mm_movemask_epi8(err) != 0;
+	return done;
+}
+
+//	32 characters -> 16 bytes per iteration, same scheme as decode_sse2()
+__attribute__((target("avx2")))
+static int decode_avx2(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad)
+{
+	const __m256i ch_0 = _mm256_set1_epi8('0');
+	const __m256i ch_a = _mm256_set1_epi8('a');
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	const __m256i nine = _mm256_set1_epi8(9);
+	const __m256i five = _mm256_set1_epi8(5);
+	const __m256i ten = _mm256_set1_epi8(10);
+	const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i err = zero;
+	__m256i acc = zero;
+	__m256i c, d, a, is_d, is_a, v, b, p;
+	__m128i acc128;
+	int done = 0;
+
+	while(byte_count - done >= 16)
+	{
+		c = _mm256_loadu_si256((const __m256i*)&src[2*done]);
+
+		d = _mm256_sub_epi8(c, ch_0);
+		is_d = _mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d);
+		a = _mm256_sub_epi8(_mm256_or_si256(c, case_bit), ch_a);
+		is_a = _mm256_cmpeq_epi8(_mm256_min_epu8(a, five), a);
+		err = _mm256_or_si256(err, _mm256_xor_si256(_mm256_or_si256(is_d, is_a), _mm256_cmpeq_epi8(zero, zero)));
+		v = _mm256_or_si256(_mm256_and_si256(is_d, d), _mm256_and_si256(is_a, _mm256_add_epi8(a, ten)));
+
+		b = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, low_byte), 4), _mm256_srli_epi16(v, 8));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(b, zero));
+
+		// packus works per 128 bit lane, gather the low qword of each lane
+		p = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0xD8);
+		_mm_storeu_si128((__m128i*)&dst[done], _mm256_castsi256_si128(p));
+		done += 16;
+	};
+
+	acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	*sum += (uint32_t)_mm_cvtsi128_si32(acc128) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(acc128, 8));
+	*bad |= _mm256_movemask_epi8(err) != 0;
+
+	// finish any 8 byte block with the narrower kernel
+	done += decode_sse2(&dst[done], &src[2*done], byte_count - done, sum, bad);
+	return done;
+}
+
+#endif
+
+#ifdef HAVE_NEON
+
+//	32 characters -> 16 bytes per iteration, vld2 de-interleaves high and low nibble characters
+static inline uint8x16_t neon_nibbles(uint8x16_t c, uint8x16_t *err)
+{
+	uint8x16_t d = vsubq_u8(c, vdupq_n_u8('0'));
+	uint8x16_t a = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+	uint8x16_t is_d = vcleq_u8(d, vdupq_n_u8(9));
+	uint8x16_t is_a = vcleq_u8(a, vdupq_n_u8(5));
+
+	*err = vorrq_u8(*err, vmvnq_u8(vorrq_u8(is_d, is_a)));
+	return vbslq_u8(is_d, d, vaddq_u8(a, vdupq_n_u8(10)));
+}
+
+static int decode_neon(uint8_t *dst, const char *src, int byte_count, uint32_t *sum, bool *bad)
+{
+	uint8x16_t err = vdupq_n_u8(0);
+	uint8x16x2_t c;
+	uint8x16_t b;
+	int done = 0;
+
+	while(byte_count - done >= 16)
+	{
+		c = vld2q_u8((const uint8_t*)&src[2*done]);
+		b = vorrq_u8(vshlq_n_u8(neon_nibbles(c.val[0], &err), 4), neon_nibbles(c.val[1], &err));
+		*sum += vaddlvq_u8(b);
+		vst1q_u8(&dst[done], b);
+		done += 16;
+	};
+
+	*bad |= vmaxvq_u8(err) != 0;
+	return done;
+}
+
+#endif
+
+#endif
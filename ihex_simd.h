@@ -0,0 +1,35 @@
+#ifndef _IHEX_SIMD_H_
+#define _IHEX_SIMD_H_
+
+	#include <stdint.h>
+
+//********************************************************************************************************
+// Public defines
+//********************************************************************************************************
+
+//	Vector hex decode kernels used by ihex.c when built with IHEX_SIMD defined (host builds).
+//	The best kernel supported by the running CPU is selected on first use, which is safe from any thread.
+	#define IHEX_SIMD_NONE		0
+	#define IHEX_SIMD_SSE2		1
+	#define IHEX_SIMD_AVX2		2
+	#define IHEX_SIMD_NEON		3
+
+//********************************************************************************************************
+// Public prototypes
+//********************************************************************************************************
+
+//	Decode as many whole kernel-width blocks of byte_count bytes (2*byte_count hex characters) as possible,
+//	 adding every decoded byte into *checksum.
+//	Returns the number of bytes decoded (the caller finishes the tail), or IHEX_ERR_HEX.
+//	dst may alias src, provided dst <= src (in-place decode of a line).
+	int ihex_simd_decode(uint8_t *dst, const char *src, int byte_count, uint8_t *checksum);
+
+//	Return the kernel in use, IHEX_SIMD_#
+	int ihex_simd_level(void);
+
+//	Select a kernel, mainly for benchmarking against the scalar path.
+//	Requests for a kernel the CPU does not support fall back to the best supported one.
+//	Returns the kernel actually selected.
+	int ihex_simd_force(int level);
+
+#endif
@@ -3,6 +3,9 @@
 
 	#include "greatest.h"
 	#include "ihex.h"
+	#ifdef IHEX_SIMD
+		#include "ihex_simd.h"
+	#endif
 
 //********************************************************************************************************
 // Configurable defines
@@ -22,19 +25,66 @@
 // Private variables
 //********************************************************************************************************
 
+//	Test sink, records what it was given
+	typedef struct collector_t
+	{
+		int records;
+		int bytes;
+		uint32_t last_address;
+		uint8_t data[1024];
+		int busy;		//	answer IHEX_SINK_BUSY this many times
+		int fail;		//	non0 to answer with this error
+		bool eof;
+	} collector_t;
+
 //********************************************************************************************************
 // Private prototypes
 //********************************************************************************************************
 
 	SUITE(ihex_suite);
+	SUITE_EXTERN(page_suite);
+	SUITE_EXTERN(file_suite);
+	SUITE_EXTERN(mt_suite);
+	SUITE_EXTERN(image_suite);
+	SUITE_EXTERN(enc_suite);
+	SUITE_EXTERN(ring_suite);
+	SUITE_EXTERN(digest_suite);
+	SUITE_EXTERN(elide_suite);
+	SUITE_EXTERN(reorder_suite);
+	SUITE_EXTERN(bin_suite);
 	TEST test_empty_input_accepts_all(void);
 	TEST test_data_record_basic(void);
 	TEST test_crlf_is_accepted(void);
 	TEST test_ext_linear_address_applies_to_next_data(void);
 	TEST test_bad_checksum_latches_error(void);
 	TEST test_eof_blocks_further_parsing(void);
+	TEST test_decode_kernels_agree(void);
+	TEST test_byte_at_a_time_matches_whole_line(void);
+	TEST test_stream_decode_context_is_compact(void);
+	TEST test_sink_parses_whole_buffer_in_one_call(void);
+	TEST test_sink_busy_applies_backpressure(void);
+	TEST test_sink_error_latches(void);
+	TEST test_parse_buffer_zero_copy(void);
+	TEST test_parse_buffer_line_rules(void);
+	TEST test_slots_parse_ahead_of_host(void);
+	TEST test_writev_parses_across_spans(void);
+	TEST test_write_line_limit_ignores_cr(void);
+	TEST test_every_character_decodes_or_fails(void);
+	TEST test_scan_builds_manifest(void);
+	TEST test_retry_resends_failing_line(void);
+	TEST test_retry_skips_lines_already_delivered(void);
+	TEST test_checkpoint_resumes_at_any_cut(void);
+	TEST test_checkpoint_rejects_damaged_blob(void);
+	TEST test_windows_clip_and_drop_records(void);
+	TEST test_fragments_carry_long_records(void);
+	TEST test_fragments_of_failed_line_are_not_committed(void);
+	TEST test_fragments_commit_inside_windows(void);
+	TEST test_runtime_sized_contexts(void);
 
 	static int feed_bytes(ihex_ctx_t *ctx, const char *s);
+	static int make_line(char *dst, uint8_t type, uint16_t address, const uint8_t *data, int len);
+	static int collect_data(void *user, uint32_t address, const uint8_t *data, int size);
+	static void collect_eof(void *user);
 
 //********************************************************************************************************
 // Public functions
@@ -44,6 +94,16 @@ int main(int argc, char **argv)
 {
 	GREATEST_MAIN_BEGIN();
 	RUN_SUITE(ihex_suite);
+	RUN_SUITE(page_suite);
+	RUN_SUITE(file_suite);
+	RUN_SUITE(mt_suite);
+	RUN_SUITE(image_suite);
+	RUN_SUITE(enc_suite);
+	RUN_SUITE(ring_suite);
+	RUN_SUITE(digest_suite);
+	RUN_SUITE(elide_suite);
+	RUN_SUITE(reorder_suite);
+	RUN_SUITE(bin_suite);
 	GREATEST_MAIN_END();
 }
 
@@ -59,6 +119,28 @@ SUITE(ihex_suite)
 	RUN_TEST(test_ext_linear_address_applies_to_next_data);
 	RUN_TEST(test_bad_checksum_latches_error);
 	RUN_TEST(test_eof_blocks_further_parsing);
+	RUN_TEST(test_decode_kernels_agree);
+	RUN_TEST(test_byte_at_a_time_matches_whole_line);
+	RUN_TEST(test_stream_decode_context_is_compact);
+	RUN_TEST(test_sink_parses_whole_buffer_in_one_call);
+	RUN_TEST(test_sink_busy_applies_backpressure);
+	RUN_TEST(test_sink_error_latches);
+	RUN_TEST(test_parse_buffer_zero_copy);
+	RUN_TEST(test_parse_buffer_line_rules);
+	RUN_TEST(test_slots_parse_ahead_of_host);
+	RUN_TEST(test_writev_parses_across_spans);
+	RUN_TEST(test_write_line_limit_ignores_cr);
+	RUN_TEST(test_every_character_decodes_or_fails);
+	RUN_TEST(test_scan_builds_manifest);
+	RUN_TEST(test_retry_resends_failing_line);
+	RUN_TEST(test_retry_skips_lines_already_delivered);
+	RUN_TEST(test_checkpoint_resumes_at_any_cut);
+	RUN_TEST(test_checkpoint_rejects_damaged_blob);
+	RUN_TEST(test_windows_clip_and_drop_records);
+	RUN_TEST(test_fragments_carry_long_records);
+	RUN_TEST(test_fragments_of_failed_line_are_not_committed);
+	RUN_TEST(test_fragments_commit_inside_windows);
+	RUN_TEST(test_runtime_sized_contexts);
 }
 
 //********************************************************************************************************
@@ -195,6 +277,880 @@ TEST test_eof_blocks_further_parsing(void)
 	PASS();
 }
 
+TEST test_decode_kernels_agree(void)
+{
+#if defined(IHEX_SIMD) && !defined(IHEX_FRAGMENT_SIZE)
+	static const int levels[] = {IHEX_SIMD_NONE, IHEX_SIMD_SSE2, IHEX_SIMD_AVX2, IHEX_SIMD_NEON};
+	uint8_t data[120];
+	char line[IHEX_LINE_LEN_MAX+1];
+	int line_len;
+	int i, j, a;
+	ihex_ctx_t ctx;
+
+	for(i=0; i < (int)sizeof(data); i++)
+		data[i] = (uint8_t)(i*7 + 3);
+	line_len = make_line(line, 0x00, 0x1234, data, sizeof(data));
+
+	for(i=0; i < (int)(sizeof(levels)/sizeof(levels[0])); i++)
+	{
+		ihex_simd_force(levels[i]);
+
+		ihex_init(&ctx);
+		a = ihex_write(&ctx, line, line_len);
+		ASSERT_EQ(line_len, a);
+		ASSERT_EQ(0x1234u, ctx.data_address);
+		ASSERT_EQ((int)sizeof(data), ctx.data_size);
+		ASSERT_MEM_EQ(data, ctx.data_buffer, sizeof(data));
+
+		// a bad digit anywhere in the line must be caught, including inside vector blocks
+		for(j=1; j < line_len-1; j += 13)
+		{
+			line_len = make_line(line, 0x00, 0x1234, data, sizeof(data));
+			line[j] = (j & 1) ? 'g':'/';
+			ihex_init(&ctx);
+			ASSERT_EQ(IHEX_ERR_HEX, ihex_write(&ctx, line, line_len));
+		};
+
+		// flip a payload digit so only the checksum catches it
+		line_len = make_line(line, 0x00, 0x1234, data, sizeof(data));
+		line[100] = (line[100] == '0') ? '1':'0';
+		ihex_init(&ctx);
+		ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_write(&ctx, line, line_len));
+		line_len = make_line(line, 0x00, 0x1234, data, sizeof(data));
+	};
+
+	ihex_simd_force(-1);
+	PASS();
+#else
+	SKIP();
+#endif
+}
+
+TEST test_byte_at_a_time_matches_whole_line(void)
+{
+	static const struct {const char *line; int err;} cases[] = {
+		{":0100000001FE\n",		IHEX_OK},
+		{"\r:0100000001FE\r\n",	IHEX_OK},
+		{"0100000001FE\n",		IHEX_ERR_START},
+		{"x0100000001FG\n",		IHEX_ERR_START},
+		{":0100000001F\n",		IHEX_ERR_LEN},
+		{":0100000001FG0\n",		IHEX_ERR_LEN},
+		{":00000001F\n",			IHEX_ERR_LEN},
+		{":0100000001FG\n",		IHEX_ERR_HEX},
+		{":0200000001FD\n",		IHEX_ERR_LEN},
+		{":0100000001FF\n",		IHEX_ERR_CHECKSUM},
+		{":00000002FE\n",		IHEX_ERR_UNSUPPORTED_RECORD},
+		{":00000101FE\n",		IHEX_ERR_EOF},
+		{":0100000400FB\n",		IHEX_ERR_EXT_ADDR},
+	};
+	ihex_ctx_t ctx;
+	int len, i, j, r;
+
+	for(i=0; i < (int)(sizeof(cases)/sizeof(cases[0])); i++)
+	{
+		len = (int)strlen(cases[i].line);
+
+		ihex_init(&ctx);
+		r = ihex_write(&ctx, cases[i].line, len);
+		ASSERT_EQ_FMT(cases[i].err ? cases[i].err:len, r, "%d");
+
+		ihex_init(&ctx);
+		for(j=0; j < len && ihex_write(&ctx, &cases[i].line[j], 1) == 1; j++);
+		ASSERT_EQ_FMT(cases[i].err, ctx.err, "%d");
+	};
+	PASS();
+}
+
+TEST test_stream_decode_context_is_compact(void)
+{
+#ifdef IHEX_STREAM_DECODE
+	ASSERT(sizeof(ihex_ctx_t) < IHEX_LINE_LEN_MAX);	// the buffered context holds IHEX_LINE_LEN_MAX characters on top of its state
+	PASS();
+#else
+	SKIP();
+#endif
+}
+
+TEST test_sink_parses_whole_buffer_in_one_call(void)
+{
+	const char file[] =
+		":020000040800F2\r\n"
+		":0400000001020304F2\r\n"
+		":0400040005060708DE\r\n"
+		":00000001FF\r\n";
+	const uint8_t expect[8] = {1,2,3,4,5,6,7,8};
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+
+	ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+	ASSERT_EQ(sizeof(file)-1, ihex_write(&ctx, file, sizeof(file)-1));
+	ASSERT_EQ(2, col.records);
+	ASSERT_EQ(8, col.bytes);
+	ASSERT_EQ(0x08000004u, col.last_address);
+	ASSERT_MEM_EQ(expect, col.data, sizeof(expect));
+	ASSERT(col.eof);
+	ASSERT(ctx.eof);
+	ASSERT_EQ(0, ctx.data_size);
+	PASS();
+}
+
+TEST test_sink_busy_applies_backpressure(void)
+{
+	const char file[] =
+		":0400000001020304F2\n"
+		":0400040005060708DE\n";
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+	int a;
+
+	col.busy = 2;
+	ihex_init_sink(&ctx, collect_data, NULL, &col);
+
+	// stops after the first line with the record still pending
+	a = ihex_write(&ctx, file, sizeof(file)-1);
+	ASSERT_EQ(20, a);
+	ASSERT_EQ(4, ctx.data_size);
+	ASSERT_EQ(0, col.records);
+
+	// still busy, nothing more accepted
+	ASSERT_EQ(0, ihex_write(&ctx, &file[a], sizeof(file)-1-a));
+
+	// sink takes the pending record, then the rest of the input
+	ASSERT_EQ((int)sizeof(file)-1-a, ihex_write(&ctx, &file[a], sizeof(file)-1-a));
+	ASSERT_EQ(2, col.records);
+	ASSERT_EQ(8, col.bytes);
+	PASS();
+}
+
+TEST test_sink_error_latches(void)
+{
+	const char line[] = ":0100000001FE\n";
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+
+	col.fail = IHEX_ERR_LEN;
+	ihex_init_sink(&ctx, collect_data, NULL, &col);
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_write(&ctx, line, sizeof(line)-1));
+	ASSERT_EQ(IHEX_ERR_LEN, ctx.err);
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_write(&ctx, line, sizeof(line)-1));
+	PASS();
+}
+
+TEST test_parse_buffer_zero_copy(void)
+{
+	const char file[] =
+		":020000040800F2\r\n"
+		"\n"
+		":0400000001020304F2\n\r"
+		":04000400050607\r08DE\r\n"		// CR inside a line is ignored too
+		":00000001FF\n";
+	const uint8_t expect[8] = {1,2,3,4,5,6,7,8};
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+	long a;
+	int split;
+
+	ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+	ASSERT_EQ((long)sizeof(file)-1, ihex_parse_buffer(&ctx, file, sizeof(file)-1));
+	ASSERT_EQ(2, col.records);
+	ASSERT_EQ(0x08000004u, col.last_address);
+	ASSERT_MEM_EQ(expect, col.data, sizeof(expect));
+	ASSERT(col.eof);
+
+	// any split point gives the same result, partial lines carry over in the context
+	for(split=1; split < (int)sizeof(file)-1; split++)
+	{
+		memset(&col, 0, sizeof(col));
+		ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+		ASSERT_EQ((long)split, ihex_parse_buffer(&ctx, file, split));
+		ASSERT_EQ((long)sizeof(file)-1-split, ihex_parse_buffer(&ctx, &file[split], sizeof(file)-1-split));
+		ASSERT_EQ(8, col.bytes);
+		ASSERT(col.eof);
+	};
+
+	// without a sink it stops at each data record, like ihex_write()
+	ihex_init(&ctx);
+	a = ihex_parse_buffer(&ctx, file, sizeof(file)-1);
+	ASSERT_EQ(0x08000000u, ctx.data_address);
+	ASSERT_EQ(4, ctx.data_size);
+	ASSERT_EQ(0L, ihex_parse_buffer(&ctx, &file[a], sizeof(file)-1-a));
+	PASS();
+}
+
+TEST test_parse_buffer_line_rules(void)
+{
+	char file[2*IHEX_LINE_LEN_MAX];
+	ihex_ctx_t ctx;
+
+	memset(file, '0', sizeof(file));
+	file[0] = ':';
+	file[IHEX_LINE_LEN_MAX+1] = '\n';
+	ihex_init(&ctx);
+	ASSERT_EQ((long)IHEX_ERR_LEN, ihex_parse_buffer(&ctx, file, IHEX_LINE_LEN_MAX+2));
+
+	ihex_init(&ctx);
+	ASSERT_EQ((long)IHEX_ERR_CHECKSUM, ihex_parse_buffer(&ctx, ":0100000001FF\r\n", 15));
+
+	ihex_init(&ctx);
+	ASSERT_EQ((long)IHEX_ERR_START, ihex_parse_buffer(&ctx, "\r\r0100000001FE\n", 16));
+	PASS();
+}
+
+TEST test_slots_parse_ahead_of_host(void)
+{
+#if defined(IHEX_SLOTS) && IHEX_SLOTS == 2
+	const char file[] =
+		":0100000011EE\n"
+		":0100010022DC\n"
+		":0100020033CA\n"
+		":00000001FF\n";
+	const int eof_at = 3*14;
+	ihex_slot_t *slot;
+	ihex_ctx_t ctx;
+	int i;
+
+	// both slots are filled, parsing only waits once a third record is ready
+	ihex_init_slots(&ctx);
+	ASSERT_EQ(eof_at, ihex_write(&ctx, file, sizeof(file)-1));
+	ASSERT_EQ(0, ihex_write(&ctx, &file[eof_at], sizeof(file)-1 - eof_at));
+
+	// the oldest record stays put while the released slot takes the third one
+	slot = ihex_slot_front(&ctx);
+	ASSERT(slot);
+	ASSERT_EQ(0u, slot->address);
+	ASSERT_EQ(1, slot->size);
+	ASSERT_EQ(0x11, slot->data[0]);
+	ihex_slot_release(&ctx);
+	ASSERT_EQ((int)sizeof(file)-1 - eof_at, ihex_write(&ctx, &file[eof_at], sizeof(file)-1 - eof_at));
+	ASSERT(ctx.eof);
+
+	for(i=1; i < 3; i++)
+	{
+		slot = ihex_slot_front(&ctx);
+		ASSERT(slot);
+		ASSERT_EQ((uint32_t)i, slot->address);
+		ASSERT_EQ(0x11 * (i+1), slot->data[0]);
+		ihex_slot_release(&ctx);
+	};
+	ASSERT_EQ(NULL, ihex_slot_front(&ctx));
+	PASS();
+#else
+	SKIP();
+#endif
+}
+
+TEST test_writev_parses_across_spans(void)
+{
+	const char dma[] = "020304F2\n:0400040005060708DE\n:020000040800F2\n:0400000001";
+	const int head = sizeof(dma)-1 - 11;
+	ihex_iovec_t iov[3];
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+
+	// a wrapped receive buffer: the tail of dma holds the start of the first line, then an empty span
+	iov[0].base = &dma[head];
+	iov[0].len = 11;
+	iov[1].base = dma;
+	iov[1].len = 0;
+	iov[2].base = dma;
+	iov[2].len = head;
+
+	ihex_init(&ctx);
+	ASSERT_EQ(11 + 9, ihex_writev(&ctx, iov, 3));		// stops after the first record, as ihex_write() does
+	ASSERT_EQ(4, ctx.data_size);
+	ASSERT_MEM_EQ("\x01\x02\x03\x04", ctx.data_buffer, 4);
+
+	ihex_init_sink(&ctx, collect_data, NULL, &col);
+	ASSERT_EQ((int)sizeof(dma)-1, ihex_writev(&ctx, iov, 3));
+	ASSERT_EQ(2, col.records);
+	ASSERT_EQ(0x00000004u, col.last_address);
+	ASSERT_MEM_EQ("\x01\x02\x03\x04\x05\x06\x07\x08", col.data, 8);
+	ASSERT_EQ(0, ctx.text_size);
+
+	iov[0].base = ":0100000001FF\n";
+	iov[0].len = 14;
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_writev(&ctx, iov, 3));
+	PASS();
+}
+
+TEST test_write_line_limit_ignores_cr(void)
+{
+	char text[2*IHEX_TEXT_LEN_MAX + 2];
+	ihex_ctx_t ctx;
+	int i, len;
+
+	// IHEX_TEXT_LEN_MAX characters with a CR after each one fill the line exactly, LEN is only raised by one more
+	for(i=0, len=0; i < IHEX_TEXT_LEN_MAX; i++)
+	{
+		text[len++] = '0';
+		text[len++] = '\r';
+	};
+	ihex_init(&ctx);
+	ASSERT_EQ(len, ihex_write(&ctx, text, len));
+	ASSERT_EQ(IHEX_TEXT_LEN_MAX, ctx.text_size);
+	ASSERT_EQ(1, ihex_write(&ctx, "\r", 1));
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_write(&ctx, "0\n", 2));
+	PASS();
+}
+
+TEST test_every_character_decodes_or_fails(void)
+{
+	uint8_t data[5];
+	char line[64];
+	ihex_ctx_t ctx;
+	int c, pos, len, value;
+
+	// every character in every data position of a 5 byte record: both halves of 4 character words, and an odd last byte
+	for(c=0; c < 256; c++)
+	{
+		if(c >= '0' && c <= '9')
+			value = c - '0';
+		else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+			value = (c | 0x20) - 'a' + 10;
+		else
+			value = -1;
+
+		for(pos=0; pos < 2*(int)sizeof(data) && c != '\n' && c != '\r'; pos++)
+		{
+			memset(data, 0x5A, sizeof(data));
+			if(value >= 0)
+				data[pos/2] = (pos & 1) ? 0x50 | value : (value << 4) | 0x0A;
+			len = make_line(line, 0x00, 0x0000, data, sizeof(data));
+			line[9 + pos] = (char)c;
+
+			ihex_init(&ctx);
+			if(value < 0)
+				ASSERT_EQ_FMT(IHEX_ERR_HEX, ihex_write(&ctx, line, len), "%d");
+			else
+			{
+				ASSERT_EQ_FMT(len, ihex_write(&ctx, line, len), "%d");
+				ASSERT_MEM_EQ(data, ctx.data_buffer, sizeof(data));
+			};
+		};
+	};
+	PASS();
+}
+
+TEST test_scan_builds_manifest(void)
+{
+	const char file[] =
+		":020000040800F2\n"
+		":0400000001020304F2\n"
+		":0400040005060708DE\n"
+		":0000000000\n"
+		":020000040801F1\n"
+		":02FFFF00AABB9B\n"
+		":00000001FF\n";
+	const uint8_t data[16] = {0};
+	char line[64];
+	ihex_manifest_t m;
+	uint32_t pages[2];
+	ihex_ctx_t ctx;
+	int len;
+
+	// 1K pages over 64K from 0x08000000, the last record is beyond it
+	ihex_manifest_init(&m, pages, 0x08000000, 0x400, 64);
+	ihex_init_scan(&ctx, &m);
+	ASSERT_EQ((int)sizeof(file)-1, ihex_write(&ctx, file, sizeof(file)-1));
+	ASSERT(ctx.eof);
+	ASSERT_EQ(0, ctx.data_size);
+
+	ASSERT_EQ(4u, m.records);
+	ASSERT_EQ(10u, m.data_bytes);
+	ASSERT_EQ(0x08000000u, m.min_address);
+	ASSERT_EQ(0x08020000u, m.max_address);
+	ASSERT_EQ(0x00000001u, pages[0]);
+	ASSERT_EQ(0u, pages[1]);
+	ASSERT(m.outside);
+
+	// records straddling either end of the bitmap still mark the pages they cover
+	ihex_manifest_init(&m, pages, 0x1000, 0x400, 4);
+	ihex_init_scan(&ctx, &m);
+	len = make_line(line, 0x00, 0x0FF8, data, 16);
+	ASSERT_EQ(len, ihex_write(&ctx, line, len));
+	ASSERT_EQ(0x00000001u, pages[0]);
+	ASSERT(m.outside);
+	len = make_line(line, 0x00, 0x1FF8, data, 16);
+	ASSERT_EQ(len, ihex_write(&ctx, line, len));
+	ASSERT_EQ(0x00000009u, pages[0]);
+
+	// a bad line fails the scan as it would fail parsing
+	ihex_manifest_init(&m, NULL, 0, 0, 0);
+	ihex_init_scan(&ctx, &m);
+	ASSERT_EQ((long)IHEX_ERR_CHECKSUM, ihex_parse_buffer(&ctx, ":0400000001020304F3\n", 20));
+	PASS();
+}
+
+TEST test_retry_resends_failing_line(void)
+{
+	const char file[] =
+		":020000040800F2\r\n"
+		":0400000001020304F2\r\n"
+		"\r\n"
+		":0400040005060708DF\r\n"		// corrupted in transit
+		":00000001FF\r\n";
+	const char resend[] =
+		":0400040005060708DE\r\n"
+		":00000001FF\r\n";
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+
+	ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_write(&ctx, file, sizeof(file)-1));
+	ASSERT_EQ(2u, ctx.line_count);
+	ASSERT_EQ(38u, ctx.line_offset);		// the blank line is carried with the failing one
+	ASSERT_EQ(1, col.records);
+
+	ihex_retry(&ctx, ctx.line_count);
+	ASSERT_EQ((int)sizeof(resend)-1, ihex_write(&ctx, resend, sizeof(resend)-1));
+	ASSERT_EQ(2, col.records);
+	ASSERT_EQ(8, col.bytes);
+	ASSERT_EQ(0x08000004u, col.last_address);
+	ASSERT(col.eof);
+	ASSERT_EQ(4u, ctx.line_count);
+	PASS();
+}
+
+TEST test_retry_skips_lines_already_delivered(void)
+{
+	const char file[] =
+		":020000040800F2\n"
+		":0400000001020304F2\n"
+		":0400040005060708DE\n"
+		":04000800090A0B0CCA\n"
+		":00000001FF\n";
+	char bad[sizeof(file)];
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+	int block;
+
+	// line 3 is corrupted, the host resends from the start of its block (line 2), the record in line 2 is not repeated
+	memcpy(bad, file, sizeof(file));
+	bad[16+20+20+3] = 'X';
+	block = 16 + 20;
+
+	ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+	ASSERT_EQ((long)IHEX_ERR_HEX, ihex_parse_buffer(&ctx, bad, sizeof(bad)-1));
+	ASSERT_EQ(3u, ctx.line_count);
+	ASSERT_EQ(56u, ctx.line_offset);
+	ASSERT_EQ(2, col.records);
+
+	ihex_retry(&ctx, 2);
+	ASSERT_EQ(0, feed_bytes(&ctx, &file[block]));
+	ASSERT_EQ(3, col.records);
+	ASSERT_EQ(12, col.bytes);
+	ASSERT_EQ(0x08000008u, col.last_address);
+	ASSERT(col.eof);
+	ASSERT_EQ(5u, ctx.line_count);
+	ASSERT_EQ((uint32_t)sizeof(file)-1, ctx.line_offset);
+	PASS();
+}
+
+TEST test_checkpoint_resumes_at_any_cut(void)
+{
+	const char file[] =
+		":020000040800F2\r\n"
+		":0400000001020304F2\r\n"
+		":020000040801F1\r\n"
+		":0400040005060708DE\r\n"
+		":00000001FF\r\n";
+	const uint8_t expect[8] = {1,2,3,4,5,6,7,8};
+	uint8_t blob[IHEX_CHECKPOINT_MAX];
+	collector_t col;
+	ihex_ctx_t ctx;
+	int cut, size;
+	uint32_t resume;
+
+	// power is lost after cut characters, the transfer carries on from the checkpoint with a new context
+	for(cut=0; cut < (int)sizeof(file)-1; cut++)
+	{
+		memset(&col, 0, sizeof(col));
+		ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+		ASSERT_EQ(cut, ihex_write(&ctx, file, cut));
+		size = ihex_checkpoint(&ctx, blob, sizeof(blob));
+		ASSERT(size > 0 && size <= IHEX_CHECKPOINT_MAX);
+
+		memset(&ctx, 0xA5, sizeof(ctx));
+		ihex_init_sink(&ctx, collect_data, collect_eof, &col);
+		ASSERT_EQ(IHEX_OK, ihex_restore(&ctx, blob, size));
+		resume = ihex_input_offset(&ctx);
+		ASSERT_EQ((uint32_t)cut, resume);
+		ASSERT_EQ((int)sizeof(file)-1-cut, ihex_write(&ctx, &file[resume], sizeof(file)-1-cut));
+
+		ASSERT_EQ(2, col.records);
+		ASSERT_MEM_EQ(expect, col.data, sizeof(expect));
+		ASSERT_EQ(0x08010004u, col.last_address);
+		ASSERT(col.eof);
+		ASSERT_EQ(5u, ctx.line_count);
+	};
+	PASS();
+}
+
+TEST test_checkpoint_rejects_damaged_blob(void)
+{
+	const char part[] = ":020000040800F2\n:04000000010203";
+	uint8_t blob[IHEX_CHECKPOINT_MAX];
+	ihex_ctx_t ctx;
+	int size;
+
+	ihex_init(&ctx);
+	ASSERT_EQ(16, ihex_write(&ctx, part, sizeof(part)-1));
+	ASSERT_EQ((int)sizeof(part)-1-16, ihex_write(&ctx, &part[16], sizeof(part)-1-16));
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_checkpoint(&ctx, blob, 20));
+	size = ihex_checkpoint(&ctx, blob, sizeof(blob));
+
+	blob[6] ^= 1;
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_restore(&ctx, blob, size));
+	blob[6] ^= 1;
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_restore(&ctx, blob, size-1));
+	ASSERT_EQ(IHEX_OK, ihex_restore(&ctx, blob, size));
+	ASSERT_EQ(0x08000000u, ctx.ext_lin_addr);
+	ASSERT_EQ((uint32_t)sizeof(part)-1, ihex_input_offset(&ctx));
+
+	// a record waiting for ihex_proceed() is not part of the saved state
+	ASSERT_EQ(5, ihex_write(&ctx, "04F2\n", 5));
+	ASSERT_EQ(4, ctx.data_size);
+	ASSERT_EQ(IHEX_SINK_BUSY, ihex_checkpoint(&ctx, blob, sizeof(blob)));
+	PASS();
+}
+
+TEST test_windows_clip_and_drop_records(void)
+{
+	const ihex_window_t app[3] = {{0x09000000, 0x100}, {0x08000008, 0x10}, {0x08000028, 4}};
+	const ihex_window_t two[2] = {{0x0C, 2}, {0x02, 2}};
+	uint8_t data[16];
+	char line[64];
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+	int i, j, len;
+
+	// 48 bytes from 0x08000000 in three records, the windows take 0x08..0x17 and 0x28..0x2B
+	ihex_init_sink(&ctx, collect_data, NULL, &col);
+	ihex_set_windows(&ctx, app, 3);
+	ASSERT_EQ(16, ihex_write(&ctx, ":020000040800F2\n", 16));
+	for(i=0; i < 4; i++)
+	{
+		for(j=0; j < 16; j++)
+			data[j] = i*16 + j;
+		len = make_line(line, 0x00, i*16, data, 16);
+		ASSERT_EQ(len, ihex_write(&ctx, line, len));
+	};
+	ASSERT_EQ(3, col.records);
+	ASSERT_EQ(20, col.bytes);
+	ASSERT_EQ(0x08, col.data[0]);
+	ASSERT_EQ(0x17, col.data[15]);
+	ASSERT_EQ(0x28, col.data[16]);
+	ASSERT_EQ(0x2B, col.data[19]);
+	ASSERT_EQ(0x08000028u, col.last_address);
+
+	// a record outside every window is still checked
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_write(&ctx, ":0100400000BE\n", 14));
+
+	// overlapping two windows with a gap between them, the record surfaces once per window in address order
+	ihex_init(&ctx);
+	ihex_set_windows(&ctx, two, 2);
+	for(j=0; j < 16; j++)
+		data[j] = j;
+	len = make_line(line, 0x00, 0, data, 16);
+	ASSERT_EQ(len, ihex_write(&ctx, line, len));
+	ASSERT_EQ(2, ctx.data_size);
+	ASSERT_EQ(0x00000002u, ctx.data_address);
+	ASSERT_MEM_EQ(&data[2], ctx.data_buffer, 2);
+	ihex_proceed(&ctx);
+	ASSERT_EQ(2, ctx.data_size);
+	ASSERT_EQ(0x0000000Cu, ctx.data_address);
+	ASSERT_MEM_EQ(&data[12], ctx.data_buffer, 2);
+	ihex_proceed(&ctx);
+	ASSERT_EQ(0, ctx.data_size);
+
+	// a busy sink is offered the first piece again, then both go
+	memset(&col, 0, sizeof(col));
+	col.busy = 1;
+	ihex_init_sink(&ctx, collect_data, NULL, &col);
+	ihex_set_windows(&ctx, two, 2);
+	ASSERT_EQ(len, ihex_write(&ctx, line, len));
+	ASSERT_EQ(0, col.records);
+	ASSERT_EQ(0, ihex_write(&ctx, line, 0));
+	ASSERT_EQ(2, col.records);
+	ASSERT_EQ(4, col.bytes);
+	ASSERT_EQ(0x02, col.data[0]);
+	ASSERT_EQ(0x0C, col.data[2]);
+	ASSERT_EQ(0x0000000Cu, col.last_address);
+	PASS();
+}
+
+TEST test_fragments_carry_long_records(void)
+{
+#ifdef IHEX_FRAGMENT_SIZE
+	uint8_t data[255];
+	uint8_t image[255];
+	char line[2*255 + 16];
+	ihex_ctx_t ctx;
+	int i, a, len;
+	int fragments = 0;
+
+	// a 255 byte record, longer than IHEX_LINE_LEN_MAX allows, with the context holding one fragment
+	ASSERT(sizeof(ctx.data_buffer) < sizeof(data));
+	for(i=0; i < (int)sizeof(data); i++)
+		data[i] = (uint8_t)(i*5 + 1);
+	len = make_line(line, 0x00, 0x1000, data, sizeof(data));
+
+	ihex_init(&ctx);
+	for(a=0; a < len; )
+	{
+		i = ihex_write(&ctx, &line[a], len-a);
+		ASSERT(i >= 0);
+		a += i;
+		if(ctx.data_size)
+		{
+			ASSERT(ctx.data_address >= 0x1000u && ctx.data_address + ctx.data_size <= 0x1000u + sizeof(data));
+			memcpy(&image[ctx.data_address - 0x1000], ctx.data_buffer, ctx.data_size);
+			fragments++;
+			// only the last fragment, once the checksum has been seen, commits the record
+			ASSERT_EQ(a == len, ctx.data_commit);
+			ihex_proceed(&ctx);
+		};
+	};
+	ASSERT_EQ((255 + IHEX_FRAGMENT_SIZE - 1) / IHEX_FRAGMENT_SIZE, fragments);
+	ASSERT_MEM_EQ(data, image, sizeof(data));
+	PASS();
+#else
+	SKIP();
+#endif
+}
+
+TEST test_fragments_of_failed_line_are_not_committed(void)
+{
+#ifdef IHEX_FRAGMENT_SIZE
+	uint8_t data[100];
+	char line[2*100 + 16];
+	collector_t col = {0};
+	ihex_ctx_t ctx;
+	int len;
+
+	memset(data, 0x5A, sizeof(data));
+	len = make_line(line, 0x00, 0x2000, data, sizeof(data));
+	line[len-2] ^= 1;		// checksum
+
+	// whole fragments go to the sink while the line is decoded, the error then rolls them back
+	ihex_init_sink(&ctx, collect_data, NULL, &col);
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_write(&ctx, line, len));
+	ASSERT_EQ(100 / IHEX_FRAGMENT_SIZE, col.records);
+	ASSERT_EQ(0u, ctx.line_count);
+
+	// retransmitted, the same fragments come again and the last one commits
+	memset(&col, 0, sizeof(col));
+	line[len-2] ^= 1;
+	ihex_retry(&ctx, 0);
+	ASSERT_EQ(len, ihex_write(&ctx, line, len));
+	ASSERT_EQ((100 + IHEX_FRAGMENT_SIZE - 1) / IHEX_FRAGMENT_SIZE, col.records);
+	ASSERT_EQ(100, col.bytes);
+	ASSERT(ctx.data_commit);
+	ASSERT_EQ(1u, ctx.line_count);
+	PASS();
+#else
+	SKIP();
+#endif
+}
+
+TEST test_fragments_commit_inside_windows(void)
+{
+#ifdef IHEX_FRAGMENT_SIZE
+	const ihex_window_t head[1] = {{0x2000, IHEX_FRAGMENT_SIZE + 8}};
+	uint8_t data[4*IHEX_FRAGMENT_SIZE];
+	char line[2*4*IHEX_FRAGMENT_SIZE + 16];
+	ihex_ctx_t ctx;
+	int i, a, len;
+	int fragments = 0;
+
+	for(i=0; i < (int)sizeof(data); i++)
+		data[i] = (uint8_t)(i*3 + 1);
+	len = make_line(line, 0x00, 0x2000, data, sizeof(data));
+
+	// the window ends early in the record, the fragment with its last byte waits for the checksum to commit
+	ihex_init(&ctx);
+	ihex_set_windows(&ctx, head, 1);
+	for(a=0; a < len; )
+	{
+		i = ihex_write(&ctx, &line[a], len-a);
+		ASSERT(i >= 0);
+		a += i;
+		if(ctx.data_size)
+		{
+			ASSERT_MEM_EQ(&data[ctx.data_address - 0x2000], ctx.data_buffer, ctx.data_size);
+			ASSERT_EQ(a == len, ctx.data_commit);
+			fragments++;
+			ihex_proceed(&ctx);
+		};
+	};
+	ASSERT_EQ(2, fragments);
+	ASSERT_EQ(0x2000u + IHEX_FRAGMENT_SIZE, ctx.data_address);
+	ASSERT(ctx.data_commit);
+
+	// if the line fails, the held fragment never goes out
+	line[len-2] ^= 1;
+	ihex_init(&ctx);
+	ihex_set_windows(&ctx, head, 1);
+	for(a=0, fragments=0; a < len; )
+	{
+		i = ihex_write(&ctx, &line[a], len-a);
+		if(i < 0)
+			break;
+		a += i;
+		if(ctx.data_size)
+		{
+			ASSERT(!ctx.data_commit);
+			fragments++;
+			ihex_proceed(&ctx);
+		};
+	};
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, i);
+	ASSERT_EQ(1, fragments);
+	PASS();
+#else
+	SKIP();
+#endif
+}
+
+TEST test_runtime_sized_contexts(void)
+{
+	static const int max_lines[] = {11, 43, IHEX_LINE_LEN_MAX};
+	static uint64_t mem[(4*sizeof(ihex_ctx_t) + 7)/8];
+	uint8_t data[255];
+	char line[IHEX_LINE_LEN_MAX+2];
+	collector_t col[4];
+	ihex_ctx_t *ctx;
+	size_t stride;
+	int i, len;
+
+	for(i=0; i < (int)sizeof(data); i++)
+		data[i] = (uint8_t)(i*7 + 1);
+
+	ASSERT_EQ(NULL, ihex_init_ex(mem, 8));
+
+	// a line of exactly max_line characters is accepted, a longer one fails unless the build limit is reached
+	for(i=0; i < (int)(sizeof(max_lines)/sizeof(max_lines[0])); i++)
+	{
+		memset(&col[0], 0, sizeof(col[0]));
+		ASSERT(ihex_ctx_size(max_lines[i]) <= sizeof(ihex_ctx_t));
+		ctx = ihex_init_ex(mem, ihex_ctx_size(max_lines[i]));
+		ASSERT(ctx != NULL);
+		ASSERT(ctx->line_max >= max_lines[i]);
+		ihex_set_sink(ctx, collect_data, NULL, &col[0]);
+
+		len = make_line(line, 0x00, 0x0100, data, (max_lines[i]-11)/2);
+		ASSERT_EQ(len, ihex_write(ctx, line, len));
+		ASSERT_EQ(IHEX_OK, ctx->err);
+		ASSERT_EQ((max_lines[i]-11)/2, col[0].bytes);
+		ASSERT_MEM_EQ(data, col[0].data, (max_lines[i]-11)/2);
+
+		if(ctx->line_max < IHEX_TEXT_LEN_MAX)
+		{
+			len = make_line(line, 0x00, 0x0100, data, (ctx->line_max-11)/2 + 1);
+			ihex_write(ctx, line, len);
+			ASSERT_EQ(IHEX_ERR_LEN, ctx->err);
+		};
+	};
+
+	// contexts packed back to back each keep to their own memory
+	stride = ihex_ctx_size(43);
+	memset(col, 0, sizeof(col));
+	for(i=0; i < 4; i++)
+	{
+		ctx = ihex_init_ex((uint8_t*)mem + i*stride, stride);
+		ASSERT(ctx != NULL);
+		ihex_set_sink(ctx, collect_data, NULL, &col[i]);
+	};
+	for(len=0; len < 44; len += 4)
+	{
+		for(i=0; i < 4; i++)
+		{
+			ctx = (ihex_ctx_t*)((uint8_t*)mem + i*stride);
+			make_line(line, 0x00, i*16, &data[i*16], 16);
+			ASSERT_EQ(4, ihex_write(ctx, &line[len], 4));
+		};
+	};
+	for(i=0; i < 4; i++)
+	{
+		ctx = (ihex_ctx_t*)((uint8_t*)mem + i*stride);
+		ASSERT_EQ(IHEX_OK, ctx->err);
+		ASSERT_EQ(1, col[i].records);
+		ASSERT_EQ((uint32_t)i*16, col[i].last_address);
+		ASSERT_MEM_EQ(&data[i*16], col[i].data, 16);
+	};
+	PASS();
+}
+
 //********************************************************************************************************
 // Private functions
 //********************************************************************************************************
+
+//	ihex_write() s one character at a time, returns the first error, or 0 once all of s has been accepted
+static int feed_bytes(ihex_ctx_t *ctx, const char *s)
+{
+	int r = 1;
+
+	while(*s && r > 0)
+	{
+		r = ihex_write(ctx, s, 1);
+		s += (r > 0) ? r:0;
+	};
+	return (r < 0) ? r:(int)strlen(s);
+}
+
+static int make_line(char *dst, uint8_t type, uint16_t address, const uint8_t *data, int len)
+{
+	static const char hex[16] = "0123456789ABCDEF";
+	uint8_t rec[4 + 255 + 1];
+	uint8_t sum = 0;
+	int i;
+	char *p = dst;
+
+	rec[0] = (uint8_t)len;
+	rec[1] = address >> 8;
+	rec[2] = address & 0xFF;
+	rec[3] = type;
+	memcpy(&rec[4], data, len);
+	for(i=0; i < len+4; i++)
+		sum += rec[i];
+	rec[len+4] = (uint8_t)(0x100 - sum);
+
+	*p++ = ':';
+	for(i=0; i < len+5; i++)
+	{
+		*p++ = hex[rec[i] >> 4];
+		*p++ = hex[rec[i] & 0x0F];
+	};
+	*p++ = '\n';
+	*p = 0;
+	return (int)(p - dst);
+}
+
+static int collect_data(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	collector_t *col = user;
+	int retval = IHEX_OK;
+
+	if(col->fail)
+		retval = col->fail;
+	else if(col->busy)
+	{
+		col->busy--;
+		retval = IHEX_SINK_BUSY;
+	}
+	else
+	{
+		if(col->bytes + size <= (int)sizeof(col->data))
+			memcpy(&col->data[col->bytes], data, size);
+		col->records++;
+		col->bytes += size;
+		col->last_address = address;
+	};
+	return retval;
+}
+
+static void collect_eof(void *user)
+{
+	collector_t *col = user;
+	col->eof = true;
+}
@@ -0,0 +1,339 @@
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <unistd.h>
+
+	#include "greatest.h"
+	#include "ihex_bin.h"
+	#include "ihex_digest.h"
+	#include "ihex_enc.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define BATCH_FILES		40
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+	static char dir[] = "/tmp/ihex_bin_XXXXXX";
+	static char names[BATCH_FILES][3][64];
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(bin_suite);
+	TEST test_bin_convert_fills_gaps_and_writes_manifest(void);
+	TEST test_bin_bad_file_leaves_no_output(void);
+	TEST test_bin_batch_converts_every_job(void);
+	TEST test_bin_outputs_agree(void);
+
+	static int write_hex(const char *path, uint32_t base, int records, int record_len, bool eof, bool bad_sum);
+	static int write_gap_hex(const char *path);
+	static long read_file(const char *path, uint8_t *dst, long dst_size);
+	static void remove_files(const ihex_bin_job_t *job);
+	static void drain(ihex_enc_t *enc, FILE *f);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(bin_suite)
+{
+	if(mkdtemp(dir))
+	{
+		RUN_TEST(test_bin_convert_fills_gaps_and_writes_manifest);
+		RUN_TEST(test_bin_bad_file_leaves_no_output);
+		RUN_TEST(test_bin_batch_converts_every_job);
+		RUN_TEST(test_bin_outputs_agree);
+		rmdir(dir);
+	};
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_bin_convert_fills_gaps_and_writes_manifest(void)
+{
+	const uint8_t a[4] = {1,2,3,4};
+	const uint8_t b[2] = {5,6};
+	char text[256];
+	char hex[96], bin_path[96], man[96];
+	uint8_t out[64];
+	ihex_bin_job_t job = {0};
+	ihex_digest_t d;
+	ihex_enc_t enc;
+	ihex_bin_t bin;
+	FILE *f;
+	long len;
+
+	snprintf(hex, sizeof(hex), "%s/gap.hex", dir);
+	snprintf(bin_path, sizeof(bin_path), "%s/gap.bin", dir);
+	snprintf(man, sizeof(man), "%s/gap.manifest", dir);
+	job.hex_path = hex;
+	job.bin_path = bin_path;
+	job.manifest_path = man;
+
+	// the highest record comes first, the lowest last
+	ihex_enc_init(&enc, text, sizeof(text), 16);
+	ihex_enc_write(&enc, 0x08000010, b, 2);
+	ihex_enc_write(&enc, 0x08000000, a, 4);
+	ihex_enc_eof(&enc);
+	f = fopen(hex, "w");
+	ASSERT(f != NULL);
+	fwrite(text, 1, enc.out_len, f);
+	fclose(f);
+
+	ihex_bin_init(&bin, 0xFF, IHEX_BIN_BUFFERED);
+	ASSERT_EQ(IHEX_OK, ihex_bin_convert(&bin, &job));
+	ihex_bin_free(&bin);
+
+	ASSERT_EQ(0x08000000u, job.base);
+	ASSERT_EQ(18u, job.size);
+	ASSERT_EQ(2u, job.records);
+	ASSERT_EQ(6u, job.data_bytes);
+	ASSERT_EQ(18, read_file(bin_path, out, sizeof(out)));
+	ASSERT_MEM_EQ(a, out, 4);
+	ASSERT_EQ(0xFF, out[4]);
+	ASSERT_EQ(0xFF, out[15]);
+	ASSERT_MEM_EQ(b, &out[16], 2);
+
+	ihex_digest_init(&d, IHEX_DIGEST_CRC32, IHEX_GAP_SKIP, 0, 0, 0);
+	ihex_digest_sink(&d, 0, out, 18);
+	ihex_digest_eof(&d);
+	ASSERT_EQ(d.crc32, job.crc32);
+
+	len = read_file(man, (uint8_t*)text, sizeof(text)-1);
+	ASSERT(len > 0);
+	text[len] = 0;
+	ASSERT(strstr(text, "base 0x08000000\n") != NULL);
+	ASSERT(strstr(text, "size 18\n") != NULL);
+	ASSERT(strstr(text, "fill 0xFF\n") != NULL);
+
+	remove_files(&job);
+	PASS();
+}
+
+TEST test_bin_bad_file_leaves_no_output(void)
+{
+	char hex[96], bin_path[96];
+	ihex_bin_job_t job = {0};
+	ihex_bin_t bin;
+
+	snprintf(hex, sizeof(hex), "%s/bad.hex", dir);
+	snprintf(bin_path, sizeof(bin_path), "%s/bad.bin", dir);
+	job.hex_path = hex;
+	job.bin_path = bin_path;
+	ihex_bin_init(&bin, 0x00, IHEX_BIN_BUFFERED);
+
+	ASSERT_EQ(0, write_hex(hex, 0, 8, 16, true, true));
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_bin_convert(&bin, &job));
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, job.err);
+	ASSERT_EQ(-1, access(bin_path, F_OK));
+
+	ASSERT_EQ(0, write_hex(hex, 0, 8, 16, false, false));
+	ASSERT_EQ(IHEX_ERR_EOF, ihex_bin_convert(&bin, &job));
+	ASSERT_EQ(-1, access(bin_path, F_OK));
+
+	// the context and buffer are good for the next file
+	ASSERT_EQ(0, write_hex(hex, 0x100, 8, 16, true, false));
+	ASSERT_EQ(IHEX_OK, ihex_bin_convert(&bin, &job));
+	ASSERT_EQ(128u, job.size);
+	ihex_bin_free(&bin);
+
+	remove_files(&job);
+	PASS();
+}
+
+TEST test_bin_batch_converts_every_job(void)
+{
+	ihex_bin_job_t jobs[BATCH_FILES];
+	uint8_t out[4];
+	int i;
+
+	// sizes vary a lot so that the runs finish unevenly and get stolen from
+	memset(jobs, 0, sizeof(jobs));
+	for(i=0; i < BATCH_FILES; i++)
+	{
+		snprintf(names[i][0], sizeof(names[i][0]), "%s/f%d.hex", dir, i);
+		snprintf(names[i][1], sizeof(names[i][1]), "%s/f%d.bin", dir, i);
+		snprintf(names[i][2], sizeof(names[i][2]), "%s/f%d.manifest", dir, i);
+		jobs[i].hex_path = names[i][0];
+		jobs[i].bin_path = names[i][1];
+		jobs[i].manifest_path = names[i][2];
+		ASSERT_EQ(0, write_hex(names[i][0], i * 0x10000, (i % 7) ? 4 : 2000, 32, true, i == 29));
+	};
+
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_bin_batch(jobs, BATCH_FILES, 4, 0xFF, IHEX_BIN_BUFFERED));
+	for(i=0; i < BATCH_FILES; i++)
+	{
+		if(i == 29)
+			ASSERT_EQ(IHEX_ERR_CHECKSUM, jobs[i].err);
+		else
+		{
+			ASSERT_EQ(IHEX_OK, jobs[i].err);
+			ASSERT_EQ((uint32_t)i * 0x10000, jobs[i].base);
+			ASSERT_EQ((i % 7) ? 128u : 64000u, jobs[i].size);
+			ASSERT_EQ(4, read_file(jobs[i].bin_path, out, sizeof(out)));
+			ASSERT_EQ((uint8_t)i, out[0]);
+		};
+		remove_files(&jobs[i]);
+	};
+
+	// more threads than jobs, and no jobs at all
+	ASSERT_EQ(0, write_hex(names[0][0], 0, 1, 4, true, false));
+	ASSERT_EQ(IHEX_OK, ihex_bin_batch(jobs, 1, 8, 0xFF, IHEX_BIN_SPARSE));
+	ASSERT_EQ(IHEX_OK, ihex_bin_batch(jobs, 0, 8, 0xFF, IHEX_BIN_MMAP));
+	remove_files(&jobs[0]);
+	PASS();
+}
+
+TEST test_bin_outputs_agree(void)
+{
+	static const int outputs[3] = {IHEX_BIN_BUFFERED, IHEX_BIN_MMAP, IHEX_BIN_SPARSE};
+	static const uint8_t fills[2] = {0x00, 0xA5};
+	char hex[96], bin_path[96];
+	ihex_bin_job_t job = {0};
+	ihex_bin_t bin;
+	uint8_t *expected = malloc(0x210000);
+	uint8_t *out = malloc(0x210000);
+	uint32_t crc = 0;
+	int f, o;
+
+	snprintf(hex, sizeof(hex), "%s/gap2m.hex", dir);
+	snprintf(bin_path, sizeof(bin_path), "%s/gap2m.bin", dir);
+	job.hex_path = hex;
+	job.bin_path = bin_path;
+	ASSERT(expected && out);
+	ASSERT_EQ(0, write_gap_hex(hex));
+
+	for(f=0; f < 2; f++)
+	{
+		for(o=0; o < 3; o++)
+		{
+			ihex_bin_init(&bin, fills[f], outputs[o]);
+			ASSERT_EQ(IHEX_OK, ihex_bin_convert(&bin, &job));
+			ihex_bin_free(&bin);
+			ASSERT_EQ(0x08000000u, job.base);
+			ASSERT_EQ(0x200080u, job.size);
+			ASSERT_EQ(0x200080, read_file(bin_path, (o == 0) ? expected:out, 0x210000));
+			if(o == 0)
+				crc = job.crc32;
+			else
+			{
+				ASSERT_EQ(crc, job.crc32);
+				ASSERT_MEM_EQ(expected, out, 0x200080);
+			};
+		};
+		ASSERT_EQ(fills[f], expected[96000]);
+		ASSERT_EQ(fills[f], expected[0x1FFFFF]);
+		ASSERT_EQ(0x77, expected[0x200000]);
+	};
+
+	// a manifest that cannot be written takes the .bin with it, whichever way it was written
+	job.manifest_path = "/nonexistent/gap2m.manifest";
+	for(o=0; o < 3; o++)
+	{
+		ihex_bin_init(&bin, 0x00, outputs[o]);
+		ASSERT_EQ(IHEX_ERR_IO, ihex_bin_convert(&bin, &job));
+		ihex_bin_free(&bin);
+		ASSERT_EQ(-1, access(bin_path, F_OK));
+	};
+	job.manifest_path = NULL;
+
+	remove_files(&job);
+	free(expected);
+	free(out);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	records of record_len bytes from base, every data byte is bits 16-23 of base
+static int write_hex(const char *path, uint32_t base, int records, int record_len, bool eof, bool bad_sum)
+{
+	uint8_t data[32];
+	char out[2*IHEX_ENC_LINE_MAX];
+	ihex_enc_t enc;
+	FILE *f = fopen(path, "w");
+	int i;
+
+	// one record per write, the encoder adds the ELA records as the address crosses 64K
+	memset(data, base >> 16, sizeof(data));
+	ihex_enc_init(&enc, out, sizeof(out), record_len);
+	for(i=0; f && i < records; i++)
+	{
+		ihex_enc_write(&enc, base + i*record_len, data, record_len);
+		if(bad_sum && i == records/2)
+			out[enc.out_len-2] = (out[enc.out_len-2] == '0') ? '1':'0';
+		drain(&enc, f);
+	};
+	if(f && eof)
+	{
+		ihex_enc_eof(&enc);
+		drain(&enc, f);
+	};
+
+	return (f && fclose(f) == 0) ? 0 : -1;
+}
+
+//	96000 bytes of 32 byte records from 0x08000000, longer than a pwrite() run, then 128 bytes of 0x77 at 0x08200000
+static int write_gap_hex(const char *path)
+{
+	uint8_t data[32];
+	char out[2*IHEX_ENC_LINE_MAX];
+	ihex_enc_t enc;
+	FILE *f = fopen(path, "w");
+	int i;
+
+	ihex_enc_init(&enc, out, sizeof(out), 32);
+	for(i=0; f && i < 3000 + 4; i++)
+	{
+		memset(data, (i < 3000) ? i:0x77, sizeof(data));
+		ihex_enc_write(&enc, (i < 3000) ? 0x08000000 + i*32 : 0x08200000 + (i-3000)*32, data, 32);
+		drain(&enc, f);
+	};
+	if(f)
+	{
+		ihex_enc_eof(&enc);
+		drain(&enc, f);
+	};
+
+	return (f && fclose(f) == 0) ? 0 : -1;
+}
+
+static long read_file(const char *path, uint8_t *dst, long dst_size)
+{
+	FILE *f = fopen(path, "rb");
+	long n = -1;
+
+	if(f)
+	{
+		n = (long)fread(dst, 1, dst_size, f);
+		fclose(f);
+	};
+	return n;
+}
+
+static void remove_files(const ihex_bin_job_t *job)
+{
+	unlink(job->hex_path);
+	unlink(job->bin_path);
+	if(job->manifest_path)
+		unlink(job->manifest_path);
+}
+
+static void drain(ihex_enc_t *enc, FILE *f)
+{
+	fwrite(enc->out, 1, enc->out_len, f);
+	ihex_enc_proceed(enc);
+}
@@ -0,0 +1,180 @@
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_digest.h"
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(digest_suite);
+	TEST test_digest_known_vectors(void);
+	TEST test_digest_fills_gaps(void);
+	TEST test_digest_clips_to_end(void);
+	TEST test_digest_ready_at_eof(void);
+
+	static int refuse_once(void *user, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(digest_suite)
+{
+	RUN_TEST(test_digest_known_vectors);
+	RUN_TEST(test_digest_fills_gaps);
+	RUN_TEST(test_digest_clips_to_end);
+	RUN_TEST(test_digest_ready_at_eof);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_digest_known_vectors(void)
+{
+	const char *two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	const uint8_t sha_abc[32] = {
+		0xBA,0x78,0x16,0xBF,0x8F,0x01,0xCF,0xEA,0x41,0x41,0x40,0xDE,0x5D,0xAE,0x22,0x23,
+		0xB0,0x03,0x61,0xA3,0x96,0x17,0x7A,0x9C,0xB4,0x10,0xFF,0x61,0xF2,0x00,0x15,0xAD};
+	const uint8_t sha_two_blocks[32] = {
+		0x24,0x8D,0x6A,0x61,0xD2,0x06,0x38,0xB8,0xE5,0xC0,0x26,0x93,0x0C,0x3E,0x60,0x39,
+		0xA3,0x3C,0xE4,0x59,0x64,0xFF,0x21,0x67,0xF6,0xEC,0xED,0xD4,0x19,0xDB,0x06,0xC1};
+	ihex_digest_t d;
+
+	ihex_digest_init(&d, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_SKIP, 0xFF, 0, 0);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&d, 0x100, (const uint8_t*)"1234", 4));
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&d, 0x200, (const uint8_t*)"56789", 5));
+	ihex_digest_eof(&d);
+	ASSERT(d.done);
+	ASSERT_EQ_FMT(0xCBF43926u, d.crc32, "%08X");
+
+	ihex_digest_init(&d, IHEX_DIGEST_SHA256, IHEX_GAP_SKIP, 0xFF, 0, 0);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&d, 0, (const uint8_t*)"abc", 3));
+	ihex_digest_eof(&d);
+	ASSERT_MEM_EQ(sha_abc, d.sha256, 32);
+
+	// 56 bytes, the padding spills into a second block
+	ihex_digest_init(&d, IHEX_DIGEST_SHA256, IHEX_GAP_SKIP, 0xFF, 0, 0);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&d, 0, (const uint8_t*)two_blocks, 20));
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&d, 20, (const uint8_t*)&two_blocks[20], 36));
+	ihex_digest_eof(&d);
+	ASSERT_MEM_EQ(sha_two_blocks, d.sha256, 32);
+	PASS();
+}
+
+TEST test_digest_fills_gaps(void)
+{
+	static uint8_t flat[0x300];
+	ihex_digest_t sparse;
+	ihex_digest_t whole;
+	int i;
+
+	// the same bytes as a flat image of 0x300 bytes from 0x1000, erased to 0xFF
+	memset(flat, 0xFF, sizeof(flat));
+	for(i=0; i < 0x80; i++)
+		flat[0x10 + i] = flat[0x200 + i] = i;
+
+	ihex_digest_init(&sparse, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_FILL, 0xFF, 0x1000, 0x1300);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&sparse, 0x1010, &flat[0x10], 0x80));
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&sparse, 0x1200, &flat[0x200], 0x80));
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_digest_sink(&sparse, 0x1100, flat, 1));
+	ihex_digest_eof(&sparse);
+
+	ihex_digest_init(&whole, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_SKIP, 0, 0, 0);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&whole, 0, flat, sizeof(flat)));
+	ihex_digest_eof(&whole);
+
+	ASSERT_EQ(0x300u, (uint32_t)sparse.length);
+	ASSERT_EQ(whole.crc32, sparse.crc32);
+	ASSERT_MEM_EQ(whole.sha256, sparse.sha256, 32);
+
+	ihex_digest_init(&sparse, IHEX_DIGEST_CRC32, IHEX_GAP_FILL, 0xFF, 0x1000, 0);
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_digest_sink(&sparse, 0x0FFF, flat, 1));
+	PASS();
+}
+
+TEST test_digest_clips_to_end(void)
+{
+	static uint8_t flat[0x100];
+	uint8_t data[0x100];
+	ihex_digest_t sparse;
+	ihex_digest_t whole;
+	int i;
+
+	// a record running over end at 0x1100 and one past it, only 0x1000-0x10FF is hashed
+	for(i=0; i < 0x100; i++)
+		data[i] = i;
+	memset(flat, 0xFF, sizeof(flat));
+	memcpy(&flat[0x80], data, 0x80);
+
+	ihex_digest_init(&sparse, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_FILL, 0xFF, 0x1000, 0x1100);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&sparse, 0x1080, data, 0x100));
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&sparse, 0x1200, data, 0x10));
+	ihex_digest_eof(&sparse);
+
+	ihex_digest_init(&whole, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_SKIP, 0, 0, 0);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&whole, 0, flat, sizeof(flat)));
+	ihex_digest_eof(&whole);
+
+	ASSERT_EQ(0x100u, (uint32_t)sparse.length);
+	ASSERT_EQ(whole.crc32, sparse.crc32);
+	ASSERT_MEM_EQ(whole.sha256, sparse.sha256, 32);
+
+	// a record wholly past end still leaves the gap up to end filled
+	ihex_digest_init(&sparse, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_FILL, 0xFF, 0x1000, 0x1100);
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&sparse, 0x1080, data, 0x80));
+	ASSERT_EQ(IHEX_OK, ihex_digest_sink(&sparse, 0x1180, data, 0x10));
+	ihex_digest_eof(&sparse);
+	ASSERT_EQ(0x100u, (uint32_t)sparse.length);
+	ASSERT_EQ(whole.crc32, sparse.crc32);
+	PASS();
+}
+
+TEST test_digest_ready_at_eof(void)
+{
+	const char file[] =
+		":020000040800F2\n"
+		":0400000001020304F2\n"
+		":0400040005060708DE\n"
+		":00000001FF\n";
+	const uint8_t bytes[8] = {1,2,3,4,5,6,7,8};
+	ihex_digest_t expect;
+	ihex_digest_t d;
+	ihex_ctx_t ctx;
+	int busy = 1;
+
+	ihex_digest_init(&expect, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_SKIP, 0, 0, 0);
+	ihex_digest_sink(&expect, 0, bytes, 8);
+	ihex_digest_eof(&expect);
+
+	// in front of a sink that is busy once, the refused record is not hashed twice
+	ihex_digest_init(&d, IHEX_DIGEST_CRC32 | IHEX_DIGEST_SHA256, IHEX_GAP_FILL, 0xFF, 0x08000000, 0);
+	d.next = refuse_once;
+	d.next_user = &busy;
+	ihex_init_sink(&ctx, ihex_digest_sink, ihex_digest_eof, &d);
+	ASSERT_EQ(20 + 16, ihex_write(&ctx, file, sizeof(file)-1));
+	ASSERT_FALSE(d.done);
+	ASSERT_EQ((int)sizeof(file)-1 - 36, ihex_write(&ctx, &file[36], sizeof(file)-1 - 36));
+	ASSERT(ctx.eof);
+	ASSERT(d.done);
+	ASSERT_EQ(expect.crc32, d.crc32);
+	ASSERT_MEM_EQ(expect.sha256, d.sha256, 32);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int refuse_once(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	int *busy = user;
+
+	(void)address;
+	(void)data;
+	(void)size;
+	return (*busy)-- > 0 ? IHEX_SINK_BUSY:IHEX_OK;
+}
@@ -0,0 +1,180 @@
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_elide.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	Records the spans passed on by ihex_elide_t
+	typedef struct span_log_t
+	{
+		int spans;
+		uint32_t address[8];
+		int size[8];
+		int busy;			//	refuse this many times,
+		int busy_after;		//	once this many spans have been taken
+	} span_log_t;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(elide_suite);
+	TEST test_elide_splits_around_long_runs(void);
+	TEST test_elide_keeps_short_runs(void);
+	TEST test_elide_busy_does_not_duplicate(void);
+	TEST test_elide_runs_across_records(void);
+
+	static int log_span(void *user, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(elide_suite)
+{
+	RUN_TEST(test_elide_splits_around_long_runs);
+	RUN_TEST(test_elide_keeps_short_runs);
+	RUN_TEST(test_elide_busy_does_not_duplicate);
+	RUN_TEST(test_elide_runs_across_records);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_elide_splits_around_long_runs(void)
+{
+	uint8_t data[64];
+	span_log_t log = {0};
+	ihex_elide_t el;
+
+	// 0xFF padding at both ends and a 20 byte hole in the middle
+	memset(data, 0xFF, sizeof(data));
+	memset(&data[8], 0x11, 10);
+	memset(&data[38], 0x22, 16);
+
+	ihex_elide_init(&el, 0xFF, 8, log_span, &log);
+	ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0x1000, data, sizeof(data)));
+	ASSERT_EQ(2, log.spans);
+	ASSERT_EQ(0x1008u, log.address[0]);
+	ASSERT_EQ(10, log.size[0]);
+	ASSERT_EQ(0x1026u, log.address[1]);
+	ASSERT_EQ(16, log.size[1]);
+	ASSERT_EQ(38u, el.elided);
+
+	// all erased, nothing is passed on
+	memset(data, 0xFF, sizeof(data));
+	ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0x2000, data, sizeof(data)));
+	ASSERT_EQ(2, log.spans);
+	ASSERT_EQ(102u, el.elided);
+	PASS();
+}
+
+TEST test_elide_keeps_short_runs(void)
+{
+	const uint8_t data[12] = {1,2,0,0,0,3,4,0,0,0,0,0};
+	span_log_t log = {0};
+	ihex_elide_t el;
+
+	// erased value 0, the run of 3 stays, the trailing run of 5 goes
+	ihex_elide_init(&el, 0x00, 4, log_span, &log);
+	ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0, data, sizeof(data)));
+	ASSERT_EQ(1, log.spans);
+	ASSERT_EQ(0u, log.address[0]);
+	ASSERT_EQ(7, log.size[0]);
+	ASSERT_EQ(5u, el.elided);
+	PASS();
+}
+
+TEST test_elide_busy_does_not_duplicate(void)
+{
+	uint8_t data[48];
+	span_log_t log = {0};
+	ihex_elide_t el;
+
+	memset(data, 0xFF, sizeof(data));
+	memset(&data[0], 0x11, 8);
+	memset(&data[24], 0x22, 8);
+	memset(&data[40], 0x33, 8);
+
+	// the second span is refused once
+	log.busy = 1;
+	log.busy_after = 1;
+	ihex_elide_init(&el, 0xFF, 8, log_span, &log);
+	ASSERT_EQ(IHEX_SINK_BUSY, ihex_elide_sink(&el, 0x100, data, sizeof(data)));
+	ASSERT_EQ(1, log.spans);
+	ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0x100, data, sizeof(data)));
+	ASSERT_EQ(3, log.spans);
+	ASSERT_EQ(0x100u, log.address[0]);
+	ASSERT_EQ(0x118u, log.address[1]);
+	ASSERT_EQ(0x128u, log.address[2]);
+	ASSERT_EQ(8, log.size[2]);
+	ASSERT_EQ(24u, el.elided);
+	PASS();
+}
+
+TEST test_elide_runs_across_records(void)
+{
+	uint8_t data[16];
+	span_log_t log = {0};
+	ihex_elide_t el;
+	int i;
+
+	// 0x44 bytes of padding over five 16 byte records, each shorter than min_run
+	memset(data, 0xFF, sizeof(data));
+	ihex_elide_init(&el, 0xFF, 24, log_span, &log);
+	for(i=0; i < 4; i++)
+		ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0x100 + i*16, data, sizeof(data)));
+	memset(&data[4], 0x11, 12);
+	ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0x140, data, sizeof(data)));
+
+	// the first record goes out whole, the padding is dropped once the run reaches 24 bytes
+	ASSERT_EQ(2, log.spans);
+	ASSERT_EQ(0x100u, log.address[0]);
+	ASSERT_EQ(16, log.size[0]);
+	ASSERT_EQ(0x144u, log.address[1]);
+	ASSERT_EQ(12, log.size[1]);
+	ASSERT_EQ(52u, el.elided);
+
+	// a gap in the addresses ends the run, the short one that follows is kept
+	memset(data, 0xFF, 8);
+	ASSERT_EQ(IHEX_OK, ihex_elide_sink(&el, 0x200, data, sizeof(data)));
+	ASSERT_EQ(3, log.spans);
+	ASSERT_EQ(0x200u, log.address[2]);
+	ASSERT_EQ(16, log.size[2]);
+	ASSERT_EQ(52u, el.elided);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int log_span(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	span_log_t *log = user;
+	int retval = IHEX_OK;
+
+	(void)data;
+	if(log->busy && log->spans >= log->busy_after)
+	{
+		log->busy--;
+		retval = IHEX_SINK_BUSY;
+	}
+	else if(log->spans < 8)
+	{
+		log->address[log->spans] = address;
+		log->size[log->spans] = size;
+		log->spans++;
+	};
+	return retval;
+}
@@ -0,0 +1,125 @@
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_enc.h"
+	#include "ihex_image.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define DATA_LEN	1000
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+	static char text[8192];
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(enc_suite);
+	TEST test_enc_produces_expected_text(void);
+	TEST test_enc_round_trip_through_small_buffer(void);
+	TEST test_enc_rejects_bad_sizes(void);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(enc_suite)
+{
+	RUN_TEST(test_enc_produces_expected_text);
+	RUN_TEST(test_enc_round_trip_through_small_buffer);
+	RUN_TEST(test_enc_rejects_bad_sizes);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_enc_produces_expected_text(void)
+{
+	const char expect[] =
+		":020000040800F2\r\n"
+		":0400000001020304F2\r\n"
+		":0400040005060708DE\r\n"
+		":00000001FF\r\n";
+	const uint8_t data[8] = {1,2,3,4,5,6,7,8};
+	char out[IHEX_ENC_LINE_MAX*4];
+	ihex_enc_t enc;
+
+	ASSERT_EQ(IHEX_OK, ihex_enc_init(&enc, out, sizeof(out), 4));
+	enc.crlf = true;
+	ASSERT_EQ(3, ihex_enc_write(&enc, 0x08000000, data, 3));		// gathered until the record is full
+	ASSERT_EQ(5, ihex_enc_write(&enc, 0x08000003, &data[3], 5));
+	ASSERT_EQ(IHEX_OK, ihex_enc_eof(&enc));
+	ASSERT_EQ((int)sizeof(expect)-1, enc.out_len);
+	ASSERT_MEM_EQ(expect, out, sizeof(expect)-1);
+	PASS();
+}
+
+TEST test_enc_round_trip_through_small_buffer(void)
+{
+	static uint8_t data[DATA_LEN];
+	static uint8_t back[DATA_LEN];
+	char out[100];
+	ihex_extent_t extents[4];
+	ihex_image_t img;
+	ihex_enc_t enc;
+	ihex_ctx_t ctx;
+	int text_len = 0;
+	int i, n, err;
+
+	for(i=0; i < DATA_LEN; i++)
+		data[i] = i * 7;
+
+	// 7 byte writes of 32 byte records across a 64K boundary, out holds only one line at a time
+	ASSERT_EQ(IHEX_OK, ihex_enc_init(&enc, out, sizeof(out), 32));
+	for(i=0; i < DATA_LEN; i+=n)
+	{
+		n = ihex_enc_write(&enc, 0x0800FF00 + i, &data[i], (DATA_LEN-i < 7) ? DATA_LEN-i : 7);
+		memcpy(&text[text_len], out, enc.out_len);
+		text_len += enc.out_len;
+		ihex_enc_proceed(&enc);
+	};
+	do
+	{
+		err = ihex_enc_eof(&enc);
+		memcpy(&text[text_len], out, enc.out_len);
+		text_len += enc.out_len;
+		ihex_enc_proceed(&enc);
+	} while(err == IHEX_SINK_BUSY);
+	ASSERT_EQ(IHEX_OK, err);
+
+	// 0x100 bytes below the boundary are 8 records, the rest another 24, plus two 04 records and the EOF
+	for(i=0, n=0; i < text_len; i++)
+		n += (text[i] == '\n');
+	ASSERT_EQ(8 + 24 + 3, n);
+
+	ihex_image_init(&img, extents, 4, back, sizeof(back));
+	ihex_init_sink(&ctx, ihex_image_sink, NULL, &img);
+	ASSERT_EQ(text_len, ihex_parse_buffer(&ctx, text, text_len));
+	ASSERT(ctx.eof);
+	ASSERT_EQ(1, img.extent_count);
+	ASSERT_EQ(0x0800FF00u, extents[0].address);
+	ASSERT_EQ((uint32_t)DATA_LEN, extents[0].size);
+	ASSERT_MEM_EQ(data, back, DATA_LEN);
+	PASS();
+}
+
+TEST test_enc_rejects_bad_sizes(void)
+{
+	char out[IHEX_ENC_LINE_MAX];
+	ihex_enc_t enc;
+
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_enc_init(&enc, out, sizeof(out), 0));
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_enc_init(&enc, out, sizeof(out), 256));
+	ASSERT_EQ(IHEX_ERR_LEN, ihex_enc_init(&enc, out, 40, 16));
+	ASSERT_EQ(IHEX_OK, ihex_enc_init(&enc, out, sizeof(out), 255));
+	PASS();
+}
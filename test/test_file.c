@@ -0,0 +1,88 @@
+
+	#include <stdint.h>
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <unistd.h>
+
+	#include "greatest.h"
+	#include "ihex_file.h"
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+	static uint32_t sum_address;
+	static int sum_bytes;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(file_suite);
+	TEST test_load_file_delivers_records(void);
+	TEST test_load_file_missing(void);
+
+	static int sum_data(void *user, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(file_suite)
+{
+	RUN_TEST(test_load_file_delivers_records);
+	RUN_TEST(test_load_file_missing);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_load_file_delivers_records(void)
+{
+	const char text[] =
+		":020000040800F2\r\n"
+		":0400000001020304F2\r\n"
+		":00000001FF\r\n";
+	char path[] = "/tmp/ihex_test_XXXXXX";
+	ihex_ctx_t ctx;
+	int fd = mkstemp(path);
+
+	ASSERT(fd >= 0);
+	ASSERT_EQ((ssize_t)sizeof(text)-1, write(fd, text, sizeof(text)-1));
+	close(fd);
+
+	sum_address = 0;
+	sum_bytes = 0;
+	ihex_init_sink(&ctx, sum_data, NULL, NULL);
+	ASSERT_EQ(IHEX_OK, ihex_load_file(&ctx, path));
+	unlink(path);
+
+	ASSERT(ctx.eof);
+	ASSERT_EQ(0x08000000u, sum_address);
+	ASSERT_EQ(4, sum_bytes);
+	PASS();
+}
+
+TEST test_load_file_missing(void)
+{
+	ihex_ctx_t ctx;
+
+	ihex_init_sink(&ctx, sum_data, NULL, NULL);
+	ASSERT_EQ(IHEX_ERR_IO, ihex_load_file(&ctx, "/nonexistent/file.hex"));
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int sum_data(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	(void)user;
+	(void)data;
+	sum_address |= address;
+	sum_bytes += size;
+	return IHEX_OK;
+}
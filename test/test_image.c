@@ -0,0 +1,134 @@
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_image.h"
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(image_suite);
+	TEST test_image_merges_contiguous_records(void);
+	TEST test_image_read_fills_gaps(void);
+	TEST test_image_out_of_order_and_overlap(void);
+	TEST test_image_full(void);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(image_suite)
+{
+	RUN_TEST(test_image_merges_contiguous_records);
+	RUN_TEST(test_image_read_fills_gaps);
+	RUN_TEST(test_image_out_of_order_and_overlap);
+	RUN_TEST(test_image_full);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_image_merges_contiguous_records(void)
+{
+	const char *hex =
+		":02FFFE00A1A2BE\n"
+		":020000040001F9\n"
+		":02000000B1B29B\n"
+		":0400100001020304E2\n"
+		":00000001FF\n";
+	ihex_extent_t extents[4];
+	uint8_t pool[64];
+	ihex_image_t img;
+	ihex_ctx_t ctx;
+
+	// records are passed straight from the parser, the first two join across the ELA change
+	ihex_image_init(&img, extents, 4, pool, sizeof(pool));
+	ihex_init_sink(&ctx, ihex_image_sink, NULL, &img);
+	ASSERT_EQ((long)strlen(hex), ihex_parse_buffer(&ctx, hex, strlen(hex)));
+	ASSERT_EQ(IHEX_OK, ctx.err);
+	ASSERT(ctx.eof);
+
+	ASSERT_EQ(2, img.extent_count);
+	ASSERT_EQ(8u, img.data_size);
+	ASSERT_EQ(0xFFFEu, extents[0].address);
+	ASSERT_EQ(4u, extents[0].size);
+	ASSERT_MEM_EQ("\xA1\xA2\xB1\xB2", ihex_image_data(&img, &extents[0]), 4);
+	ASSERT_EQ(0x10010u, extents[1].address);
+	ASSERT_EQ(4u, extents[1].size);
+	PASS();
+}
+
+TEST test_image_read_fills_gaps(void)
+{
+	const uint8_t a[4] = {1,2,3,4};
+	const uint8_t b[2] = {5,6};
+	ihex_extent_t extents[4];
+	uint8_t pool[16];
+	uint8_t dst[12];
+	ihex_image_t img;
+
+	ihex_image_init(&img, extents, 4, pool, sizeof(pool));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x102, a, 4));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x108, b, 2));
+
+	ASSERT_EQ(6u, ihex_image_read(&img, 0x100, dst, 12, 0xFF));
+	ASSERT_MEM_EQ("\xFF\xFF\x01\x02\x03\x04\xFF\xFF\x05\x06\xFF\xFF", dst, 12);
+
+	// starting and ending inside extents
+	ASSERT_EQ(3u, ihex_image_read(&img, 0x104, dst, 5, 0x00));
+	ASSERT_MEM_EQ("\x03\x04\x00\x00\x05", dst, 5);
+
+	ASSERT_EQ(0u, ihex_image_read(&img, 0x200, dst, 4, 0xEE));
+	ASSERT_MEM_EQ("\xEE\xEE\xEE\xEE", dst, 4);
+
+	ASSERT_EQ(0, ihex_image_find(&img, 0x0));
+	ASSERT_EQ(0, ihex_image_find(&img, 0x105));
+	ASSERT_EQ(1, ihex_image_find(&img, 0x106));
+	ASSERT_EQ(2, ihex_image_find(&img, 0x10A));
+	PASS();
+}
+
+TEST test_image_out_of_order_and_overlap(void)
+{
+	const uint8_t data[4] = {1,2,3,4};
+	ihex_extent_t extents[4];
+	uint8_t pool[32];
+	ihex_image_t img;
+
+	ihex_image_init(&img, extents, 4, pool, sizeof(pool));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x200, data, 4));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x100, data, 4));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x1FC, data, 4));	// adjacent below, but its data is not at the pool end
+	ASSERT_EQ(3, img.extent_count);
+	ASSERT_EQ(0x100u, extents[0].address);
+	ASSERT_EQ(0x1FCu, extents[1].address);
+	ASSERT_EQ(0x200u, extents[2].address);
+
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_image_sink(&img, 0x102, data, 4));
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_image_sink(&img, 0x0FE, data, 4));
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_image_sink(&img, 0x1F0, data, 0x0D));
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_image_sink(&img, 0xFFFFFFFE, data, 4));
+	ASSERT_EQ(3, img.extent_count);
+	ASSERT_EQ(12u, img.data_size);
+	PASS();
+}
+
+TEST test_image_full(void)
+{
+	const uint8_t data[4] = {1,2,3,4};
+	ihex_extent_t extents[2];
+	uint8_t pool[10];
+	ihex_image_t img;
+
+	ihex_image_init(&img, extents, 2, pool, sizeof(pool));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x0, data, 4));
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x10, data, 4));
+	ASSERT_EQ(IHEX_ERR_FULL, ihex_image_sink(&img, 0x20, data, 2));		// no extent left
+	ASSERT_EQ(IHEX_OK, ihex_image_sink(&img, 0x14, data, 2));			// grows the last one
+	ASSERT_EQ(IHEX_ERR_FULL, ihex_image_sink(&img, 0x16, data, 1));		// no pool left
+	ASSERT_EQ(10u, img.data_size);
+	PASS();
+}
@@ -0,0 +1,285 @@
+
+	#include <stdint.h>
+	#include <stdlib.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_mt.h"
+	#include "ihex_enc.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define CORPUS_LINES	12000
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	Running digest of everything a sink was given, in order
+	typedef struct trace_t
+	{
+		uint32_t hash;
+		int records;
+		long bytes;
+		int eofs;
+		int refuse_at;		//	answer refusal while offered record refuse_at (counting from 1), 0 for never
+		int refusal;
+	} trace_t;
+
+	static char corpus[CORPUS_LINES * 80];
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(mt_suite);
+	TEST test_parallel_matches_sequential(void);
+	TEST test_parallel_first_error_in_file_order(void);
+	TEST test_parallel_stops_at_eof(void);
+	TEST test_parallel_sink_refusal_leaves_record_pending(void);
+
+	static char* make_corpus(long *len);
+	static int trace_data(void *user, uint32_t address, const uint8_t *data, int size);
+	static void trace_eof(void *user);
+	static int run_both(const char *src, long len, trace_t *seq, trace_t *par, ihex_ctx_t *seq_ctx, ihex_ctx_t *par_ctx);
+	static int run_refused(const char *src, long len, trace_t *seq, trace_t *par, ihex_ctx_t *seq_ctx, ihex_ctx_t *par_ctx, int refusal);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(mt_suite)
+{
+	RUN_TEST(test_parallel_matches_sequential);
+	RUN_TEST(test_parallel_first_error_in_file_order);
+	RUN_TEST(test_parallel_stops_at_eof);
+	RUN_TEST(test_parallel_sink_refusal_leaves_record_pending);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_parallel_matches_sequential(void)
+{
+	trace_t seq, par;
+	ihex_ctx_t seq_ctx, par_ctx;
+	long len;
+	char *src = make_corpus(&len);
+
+	// leave a partial line at the end, it must stay in the context
+	run_both(src, len - 5, &seq, &par, &seq_ctx, &par_ctx);
+	ASSERT(seq.records > 1000);
+	ASSERT_EQ(seq.records, par.records);
+	ASSERT_EQ(seq.hash, par.hash);
+	ASSERT_EQ(seq_ctx.ext_lin_addr, par_ctx.ext_lin_addr);
+	ASSERT_EQ(seq_ctx.text_size, par_ctx.text_size);
+	ASSERT_EQ(seq_ctx.line_count, par_ctx.line_count);
+	ASSERT_EQ(seq_ctx.line_offset, par_ctx.line_offset);
+	ASSERT_EQ(ihex_input_offset(&seq_ctx), ihex_input_offset(&par_ctx));
+	ASSERT_EQ(false, par_ctx.eof);
+
+	run_both(src, len, &seq, &par, &seq_ctx, &par_ctx);
+	ASSERT_EQ(seq.hash, par.hash);
+	ASSERT_EQ(CORPUS_LINES + 1, par_ctx.line_count);
+	ASSERT_EQ((uint32_t)len, par_ctx.line_offset);
+	ASSERT_EQ(1, par.eofs);
+	ASSERT(par_ctx.eof);
+	PASS();
+}
+
+TEST test_parallel_first_error_in_file_order(void)
+{
+	trace_t seq, par;
+	ihex_ctx_t seq_ctx, par_ctx;
+	long len, q;
+	char *src = make_corpus(&len);
+	char *p;
+	char c;
+	int i;
+
+	// corrupt a checksum late in the file and a hex digit in the middle, the middle one must win
+	p = memchr(&src[len*3/4], '\n', len/4);
+	p[-1] ^= 1;
+	p = memchr(&src[len/2], '\n', len/4);
+	c = p[5];
+	p[5] = 'x';
+
+	ASSERT_EQ(IHEX_ERR_HEX, run_both(src, len, &seq, &par, &seq_ctx, &par_ctx));
+	ASSERT_EQ(IHEX_ERR_HEX, seq_ctx.err);
+	ASSERT_EQ(IHEX_ERR_HEX, par_ctx.err);
+	ASSERT_EQ(seq.records, par.records);
+	ASSERT_EQ(seq.hash, par.hash);
+	ASSERT_EQ(seq_ctx.line_count, par_ctx.line_count);
+	ASSERT_EQ(seq_ctx.line_offset, par_ctx.line_offset);
+	ASSERT_EQ(ihex_input_offset(&seq_ctx), ihex_input_offset(&par_ctx));
+
+	// resent from three lines back, the lines already parsed are skipped and the late error is found
+	p[5] = c;
+	q = seq_ctx.line_offset;
+	for(i=0; i < 3; i++)
+	{
+		for(q--; q > 0 && src[q-1] != '\n'; q--)
+			;
+	};
+	ihex_retry(&seq_ctx, seq_ctx.line_count - 3);
+	ihex_retry(&par_ctx, par_ctx.line_count - 3);
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_parse_buffer(&seq_ctx, &src[q], len - q));
+	ASSERT_EQ(IHEX_ERR_CHECKSUM, ihex_parse_parallel(&par_ctx, &src[q], len - q, 4));
+	ASSERT_EQ(seq.records, par.records);
+	ASSERT_EQ(seq.hash, par.hash);
+	ASSERT_EQ(seq_ctx.line_count, par_ctx.line_count);
+	PASS();
+}
+
+TEST test_parallel_stops_at_eof(void)
+{
+	trace_t seq, par;
+	ihex_ctx_t seq_ctx, par_ctx;
+	long len;
+	char *src = make_corpus(&len);
+	char *p;
+
+	// an EOF record a third of the way in, followed by garbage that must never be parsed
+	p = memchr(&src[len/3], '\n', len/4) + 1;
+	memcpy(p, ":00000001FF\n", 12);
+	p[12] = '!';
+
+	ASSERT_EQ(IHEX_OK, run_both(src, len, &seq, &par, &seq_ctx, &par_ctx));
+	ASSERT(par_ctx.eof);
+	ASSERT_EQ(IHEX_OK, par_ctx.err);
+	ASSERT_EQ(1, par.eofs);
+	ASSERT_EQ(seq.records, par.records);
+	ASSERT_EQ(seq.hash, par.hash);
+	ASSERT_EQ(seq_ctx.line_count, par_ctx.line_count);
+	ASSERT_EQ(seq_ctx.line_offset, par_ctx.line_offset);
+	PASS();
+}
+
+TEST test_parallel_sink_refusal_leaves_record_pending(void)
+{
+	static const int refusals[2] = {IHEX_SINK_BUSY, IHEX_ERR_FULL};
+	trace_t seq, par;
+	ihex_ctx_t seq_ctx, par_ctx;
+	long len, pos;
+	char *src = make_corpus(&len);
+	int i;
+
+	// the record refused comes well after an 04 record inside its piece, so its ELA is not the piece's first
+	for(i=0; i < 2; i++)
+	{
+		ASSERT_EQ(refusals[i], run_refused(src, len, &seq, &par, &seq_ctx, &par_ctx, refusals[i]));
+		ASSERT_EQ(seq.records, par.records);
+		ASSERT_EQ(seq.hash, par.hash);
+		ASSERT_EQ(seq_ctx.err, par_ctx.err);
+		ASSERT(par_ctx.data_size > 0);
+		ASSERT_EQ(seq_ctx.data_size, par_ctx.data_size);
+		ASSERT_EQ(seq_ctx.data_address, par_ctx.data_address);
+		ASSERT_MEM_EQ(seq_ctx.data_buffer, par_ctx.data_buffer, seq_ctx.data_size);
+		ASSERT_EQ(seq_ctx.ext_lin_addr, par_ctx.ext_lin_addr);
+		ASSERT_EQ(seq_ctx.line_count, par_ctx.line_count);
+		ASSERT_EQ(ihex_input_offset(&seq_ctx), ihex_input_offset(&par_ctx));
+	};
+
+	// once busy, the pending record is offered again and the rest of the input follows where it left off
+	run_refused(src, len, &seq, &par, &seq_ctx, &par_ctx, IHEX_SINK_BUSY);
+	pos = ihex_input_offset(&seq_ctx);
+	seq.refuse_at = par.refuse_at = 0;
+	ASSERT(ihex_parse_buffer(&seq_ctx, &src[pos], len - pos) >= 0);
+	ASSERT_EQ(IHEX_OK, ihex_parse_parallel(&par_ctx, &src[pos], len - pos, 4));
+	ASSERT(par_ctx.eof);
+	ASSERT_EQ(seq.records, par.records);
+	ASSERT_EQ(seq.bytes, par.bytes);
+	ASSERT_EQ(seq.hash, par.hash);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	As run_both(), with both sinks refusing the same record
+static int run_refused(const char *src, long len, trace_t *seq, trace_t *par, ihex_ctx_t *seq_ctx, ihex_ctx_t *par_ctx, int refusal)
+{
+	memset(seq, 0, sizeof(*seq));
+	memset(par, 0, sizeof(*par));
+	seq->refuse_at = par->refuse_at = CORPUS_LINES*5/12;
+	seq->refusal = par->refusal = refusal;
+
+	ihex_init_sink(seq_ctx, trace_data, trace_eof, seq);
+	ihex_parse_buffer(seq_ctx, src, len);
+
+	ihex_init_sink(par_ctx, trace_data, trace_eof, par);
+	return ihex_parse_parallel(par_ctx, src, len, 4);
+}
+
+static int run_both(const char *src, long len, trace_t *seq, trace_t *par, ihex_ctx_t *seq_ctx, ihex_ctx_t *par_ctx)
+{
+	memset(seq, 0, sizeof(*seq));
+	memset(par, 0, sizeof(*par));
+
+	ihex_init_sink(seq_ctx, trace_data, trace_eof, seq);
+	ihex_parse_buffer(seq_ctx, src, len);
+
+	ihex_init_sink(par_ctx, trace_data, trace_eof, par);
+	return ihex_parse_parallel(par_ctx, src, len, 4);
+}
+
+//	Records of varying length with frequent 04 records and mixed line endings
+static char* make_corpus(long *len)
+{
+	uint8_t data[32];
+	uint32_t address = 0;
+	ihex_enc_t enc;
+	int i, j, n;
+
+	// every 97th line is an 04 record, the encoder emits it with the data record that follows
+	srand(1);
+	ihex_enc_init(&enc, corpus, sizeof(corpus), 32);
+	for(i=0; i < CORPUS_LINES; i++)
+	{
+		enc.crlf = i & 1;
+		if(i % 97 == 0)
+			address = (uint32_t)rand() << 16;
+		else
+		{
+			n = 1 + rand() % 32;
+			for(j=0; j < n; j++)
+				data[j] = rand();
+			ihex_enc_write(&enc, address, data, n);
+			ihex_enc_flush(&enc);
+			address += n;
+		};
+	};
+	ihex_enc_eof(&enc);
+
+	*len = enc.out_len;
+	return corpus;
+}
+
+static int trace_data(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	trace_t *t = user;
+	int retval = IHEX_OK;
+	int i;
+
+	if(t->records + 1 == t->refuse_at)
+		retval = t->refusal;
+	else
+	{
+		t->hash = (t->hash ^ address) * 16777619u;
+		for(i=0; i < size; i++)
+			t->hash = (t->hash ^ data[i]) * 16777619u;
+		t->records++;
+		t->bytes += size;
+	};
+	return retval;
+}
+
+static void trace_eof(void *user)
+{
+	trace_t *t = user;
+	t->eofs++;
+}
@@ -0,0 +1,185 @@
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_page.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define PAGE_SIZE	64
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	Records the pages handed out by ihex_page_t
+	typedef struct page_log_t
+	{
+		int pages;
+		uint32_t address[8];
+		uint8_t data[8][PAGE_SIZE];
+		int busy;
+	} page_log_t;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(page_suite);
+	TEST test_page_coalesces_contiguous_records(void);
+	TEST test_page_gap_flushes_partial_page(void);
+	TEST test_page_busy_does_not_duplicate(void);
+	TEST test_page_rejects_records_out_of_order(void);
+
+	static int log_page(void *user, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(page_suite)
+{
+	RUN_TEST(test_page_coalesces_contiguous_records);
+	RUN_TEST(test_page_gap_flushes_partial_page);
+	RUN_TEST(test_page_busy_does_not_duplicate);
+	RUN_TEST(test_page_rejects_records_out_of_order);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_page_coalesces_contiguous_records(void)
+{
+	uint8_t buffer[PAGE_SIZE];
+	uint8_t data[16];
+	page_log_t log = {0};
+	ihex_page_t pg;
+	int i;
+
+	// eight 16 byte records starting mid-page, crossing a 64K (ELA) boundary
+	ihex_page_init(&pg, buffer, PAGE_SIZE, 0xFF, log_page, &log);
+	for(i=0; i < 8; i++)
+	{
+		memset(data, i, sizeof(data));
+		ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x0800FFE0 + i*16, data, sizeof(data)));
+	};
+
+	// the partial first page goes out when the records move on to the next page, the second once it is full
+	ASSERT_EQ(2, log.pages);
+	ASSERT_EQ(0x0800FFC0u, log.address[0]);
+	ASSERT_EQ(0xFF, log.data[0][0]);
+	ASSERT_EQ(0x00, log.data[0][0x20]);
+	ASSERT_EQ(0x01, log.data[0][0x3F]);
+	ASSERT_EQ(0x08010000u, log.address[1]);
+	ASSERT_EQ(0x02, log.data[1][0]);
+	ASSERT_EQ(0x05, log.data[1][0x3F]);
+
+	ASSERT_EQ(IHEX_OK, ihex_page_flush(&pg));
+	ASSERT_EQ(3, log.pages);
+	ASSERT_EQ(0x08010040u, log.address[2]);
+	ASSERT_EQ(0x07, log.data[2][0x1F]);
+	ASSERT_EQ(0xFF, log.data[2][0x20]);
+	PASS();
+}
+
+TEST test_page_gap_flushes_partial_page(void)
+{
+	uint8_t buffer[PAGE_SIZE];
+	const uint8_t data[4] = {1,2,3,4};
+	page_log_t log = {0};
+	ihex_page_t pg;
+
+	ihex_page_init(&pg, buffer, PAGE_SIZE, 0xA5, log_page, &log);
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x100, data, 4));
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x110, data, 4));	// same page, gap is filled
+	ASSERT_EQ(0, log.pages);
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x400, data, 4));	// another page
+	ASSERT_EQ(1, log.pages);
+	ASSERT_EQ(0x100u, log.address[0]);
+	ASSERT_EQ(0x04, log.data[0][3]);
+	ASSERT_EQ(0xA5, log.data[0][4]);
+	ASSERT_EQ(0x01, log.data[0][0x10]);
+	PASS();
+}
+
+TEST test_page_busy_does_not_duplicate(void)
+{
+	uint8_t buffer[PAGE_SIZE];
+	uint8_t data[96];
+	page_log_t log = {0};
+	ihex_page_t pg;
+	int i;
+
+	for(i=0; i < (int)sizeof(data); i++)
+		data[i] = i;
+
+	// record fills page 0 and half of page 1, page 0 is refused once
+	ihex_page_init(&pg, buffer, PAGE_SIZE, 0xFF, log_page, &log);
+	log.busy = 1;
+	ASSERT_EQ(IHEX_SINK_BUSY, ihex_page_sink(&pg, 0, data, sizeof(data)));
+	ASSERT_EQ(0, log.pages);
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0, data, sizeof(data)));
+	ASSERT_EQ(1, log.pages);
+	ASSERT_EQ(IHEX_OK, ihex_page_flush(&pg));
+	ASSERT_EQ(2, log.pages);
+	ASSERT_EQ(0x40u, log.address[1]);
+	ASSERT_MEM_EQ(&data[64], log.data[1], 32);
+	ASSERT_EQ(0xFF, log.data[1][32]);
+	PASS();
+}
+
+TEST test_page_rejects_records_out_of_order(void)
+{
+	uint8_t buffer[PAGE_SIZE];
+	uint8_t data[32];
+	page_log_t log = {0};
+	ihex_page_t pg;
+
+	memset(data, 0x11, sizeof(data));
+	ihex_page_init(&pg, buffer, PAGE_SIZE, 0xFF, log_page, &log);
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x100, data, 32));
+
+	// overlapping the last record, the page would go out before all of it was written
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_page_sink(&pg, 0x110, data, 32));
+	ASSERT_EQ(0, log.pages);
+
+	// back into a page already passed on, it would come round again as fill
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x120, data, 32));
+	ASSERT_EQ(1, log.pages);
+	ASSERT_EQ(IHEX_ERR_OVERLAP, ihex_page_sink(&pg, 0x0C0, data, 4));
+	ASSERT_EQ(1, log.pages);
+
+	// carrying on in order is fine
+	ASSERT_EQ(IHEX_OK, ihex_page_sink(&pg, 0x140, data, 4));
+	ASSERT_EQ(IHEX_OK, ihex_page_flush(&pg));
+	ASSERT_EQ(2, log.pages);
+	ASSERT_EQ(0x140u, log.address[1]);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int log_page(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	page_log_t *log = user;
+	int retval = IHEX_OK;
+
+	if(log->busy)
+	{
+		log->busy--;
+		retval = IHEX_SINK_BUSY;
+	}
+	else if(log->pages < 8 && size == PAGE_SIZE)
+	{
+		log->address[log->pages] = address;
+		memcpy(log->data[log->pages], data, size);
+		log->pages++;
+	};
+	return retval;
+}
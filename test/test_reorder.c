@@ -0,0 +1,177 @@
+
+	#include <stdint.h>
+	#include <string.h>
+
+	#include "greatest.h"
+	#include "ihex_reorder.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define SLOT_SIZE	16
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	Records the order ihex_reorder_t passes records on in
+	typedef struct order_log_t
+	{
+		int records;
+		uint32_t address[16];
+		uint8_t first[16];		//	first data byte
+		int busy;
+	} order_log_t;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(reorder_suite);
+	TEST test_reorder_sorts_within_window(void);
+	TEST test_reorder_passes_through_beyond_window(void);
+	TEST test_reorder_busy_does_not_duplicate(void);
+
+	static int offer(ihex_reorder_t *ro, uint32_t address, int size);
+	static int log_order(void *user, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(reorder_suite)
+{
+	RUN_TEST(test_reorder_sorts_within_window);
+	RUN_TEST(test_reorder_passes_through_beyond_window);
+	RUN_TEST(test_reorder_busy_does_not_duplicate);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_reorder_sorts_within_window(void)
+{
+	ihex_reorder_slot_t slots[4];
+	uint8_t pool[4 * SLOT_SIZE];
+	order_log_t log = {0};
+	ihex_reorder_t ro;
+
+	// vector table last, two sections interleaved
+	ihex_reorder_init(&ro, slots, 4, pool, SLOT_SIZE, log_order, &log);
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x100, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x200, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x110, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x000, 16));
+	ASSERT_EQ(0, log.records);
+
+	ASSERT_EQ(IHEX_OK, ihex_reorder_flush(&ro));
+	ASSERT_EQ(4, log.records);
+	ASSERT_EQ(0x000u, log.address[0]);
+	ASSERT_EQ(0x100u, log.address[1]);
+	ASSERT_EQ(0x110u, log.address[2]);
+	ASSERT_EQ(0x200u, log.address[3]);
+	ASSERT_EQ(0x11, log.first[2]);
+	ASSERT_EQ(4u, ro.records);
+	ASSERT_EQ(2u, ro.in_order);
+	ASSERT_EQ(0u, ro.passed);
+
+	// ordered input just flows through once the window is full
+	memset(&log, 0, sizeof(log));
+	ihex_reorder_init(&ro, slots, 4, pool, SLOT_SIZE, log_order, &log);
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x00, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x10, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x20, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x30, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x40, 16));
+	ASSERT_EQ(1, log.records);
+	ASSERT_EQ(ro.records, ro.in_order);
+	PASS();
+}
+
+TEST test_reorder_passes_through_beyond_window(void)
+{
+	ihex_reorder_slot_t slots[2];
+	uint8_t pool[2 * SLOT_SIZE];
+	order_log_t log = {0};
+	ihex_reorder_t ro;
+
+	ihex_reorder_init(&ro, slots, 2, pool, SLOT_SIZE, log_order, &log);
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x40, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x30, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x20, 16));		// window full and lowest, goes straight on
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x10, 16));		// below what has gone, out of order
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x80, 32));		// too big for a slot, held records go first
+	ASSERT_EQ(IHEX_OK, ihex_reorder_flush(&ro));
+
+	ASSERT_EQ(5, log.records);
+	ASSERT_EQ(0x20u, log.address[0]);
+	ASSERT_EQ(0x10u, log.address[1]);
+	ASSERT_EQ(0x30u, log.address[2]);
+	ASSERT_EQ(0x40u, log.address[3]);
+	ASSERT_EQ(0x80u, log.address[4]);
+	ASSERT_EQ(2u, ro.passed);
+	PASS();
+}
+
+TEST test_reorder_busy_does_not_duplicate(void)
+{
+	ihex_reorder_slot_t slots[2];
+	uint8_t pool[2 * SLOT_SIZE];
+	order_log_t log = {0};
+	ihex_reorder_t ro;
+
+	ihex_reorder_init(&ro, slots, 2, pool, SLOT_SIZE, log_order, &log);
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x20, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x00, 16));
+
+	// making room is refused, the record is offered again
+	log.busy = 1;
+	ASSERT_EQ(IHEX_SINK_BUSY, offer(&ro, 0x10, 16));
+	ASSERT_EQ(IHEX_OK, offer(&ro, 0x10, 16));
+	log.busy = 1;
+	ASSERT_EQ(IHEX_SINK_BUSY, ihex_reorder_flush(&ro));
+	ASSERT_EQ(IHEX_OK, ihex_reorder_flush(&ro));
+
+	ASSERT_EQ(3, log.records);
+	ASSERT_EQ(0x00u, log.address[0]);
+	ASSERT_EQ(0x10u, log.address[1]);
+	ASSERT_EQ(0x20u, log.address[2]);
+	ASSERT_EQ(3u, ro.records);
+	ASSERT_EQ(2u, ro.in_order);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	A record of size bytes, each the low byte of its address >> 4
+static int offer(ihex_reorder_t *ro, uint32_t address, int size)
+{
+	uint8_t data[64];
+
+	memset(data, (uint8_t)(address >> 4), size);
+	return ihex_reorder_sink(ro, address, data, size);
+}
+
+static int log_order(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	order_log_t *log = user;
+	int retval = IHEX_OK;
+
+	(void)size;
+	if(log->busy)
+	{
+		log->busy--;
+		retval = IHEX_SINK_BUSY;
+	}
+	else if(log->records < 16)
+	{
+		log->address[log->records] = address;
+		log->first[log->records] = data[0];
+		log->records++;
+	};
+	return retval;
+}
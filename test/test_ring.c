@@ -0,0 +1,208 @@
+
+	#include <stdint.h>
+	#include <string.h>
+	#include <pthread.h>
+	#include <sched.h>
+
+	#include "greatest.h"
+	#include "ihex_ring.h"
+	#include "ihex_enc.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define RING_SIZE		64
+	#define STRESS_BYTES	0x10000
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+//	Running digest of everything a sink was given, in order
+	typedef struct digest_t
+	{
+		uint32_t hash;
+		int bytes;
+	} digest_t;
+
+	typedef struct producer_t
+	{
+		ihex_ring_t *ring;
+		const char *src;
+		int len;
+	} producer_t;
+
+	static char corpus[STRESS_BYTES * 3];
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	SUITE(ring_suite);
+	TEST test_ring_drains_across_wrap(void);
+	TEST test_ring_counts_overruns(void);
+	TEST test_ring_two_thread_stress(void);
+
+	static int make_corpus(void);
+	static void* produce(void *arg);
+	static int digest_data(void *user, uint32_t address, const uint8_t *data, int size);
+
+//********************************************************************************************************
+// Suites
+//********************************************************************************************************
+
+SUITE(ring_suite)
+{
+	RUN_TEST(test_ring_drains_across_wrap);
+	RUN_TEST(test_ring_counts_overruns);
+	RUN_TEST(test_ring_two_thread_stress);
+}
+
+//********************************************************************************************************
+// Tests
+//********************************************************************************************************
+
+TEST test_ring_drains_across_wrap(void)
+{
+	const char line[] = ":0400000001020304F2\n";
+	char buffer[16];
+	ihex_ring_t ring;
+	ihex_ctx_t ctx;
+	int i;
+
+	// the line straddles the end of the buffer
+	ihex_ring_init(&ring, buffer, sizeof(buffer));
+	for(i=0; i < 10; i++)
+		ihex_ring_push(&ring, '\n');
+	ihex_init(&ctx);
+	ASSERT_EQ(10, ihex_ring_drain(&ring, &ctx));
+
+	for(i=0; i < 16; i++)
+		ASSERT(ihex_ring_push(&ring, line[i]));
+	ASSERT_EQ(16, ihex_ring_drain(&ring, &ctx));
+	for(; i < (int)sizeof(line)-1; i++)
+		ASSERT(ihex_ring_push(&ring, line[i]));
+	ASSERT_EQ(4, ihex_ring_drain(&ring, &ctx));
+
+	ASSERT_EQ(4, ctx.data_size);
+	ASSERT_MEM_EQ("\x01\x02\x03\x04", ctx.data_buffer, 4);
+	ASSERT_EQ(0u, ihex_ring_count(&ring));
+	PASS();
+}
+
+TEST test_ring_counts_overruns(void)
+{
+	char buffer[4];
+	ihex_ring_t ring;
+	ihex_ctx_t ctx;
+
+	// a data record stops the drain, what follows it stays queued
+	ihex_ring_init(&ring, buffer, sizeof(buffer));
+	ASSERT(ihex_ring_push(&ring, '\n'));
+	ASSERT(ihex_ring_push(&ring, '\r'));
+	ASSERT(ihex_ring_push(&ring, '\n'));
+	ASSERT(ihex_ring_push(&ring, ':'));
+	ASSERT_FALSE(ihex_ring_push(&ring, '0'));
+	ASSERT_EQ(1u, atomic_load(&ring.overruns));
+	ASSERT_EQ(4u, ihex_ring_count(&ring));
+
+	ihex_init(&ctx);
+	ASSERT_EQ(4, ihex_ring_drain(&ring, &ctx));
+	ASSERT(ihex_ring_push(&ring, 'x'));
+	ASSERT_EQ(1u, ihex_ring_count(&ring));
+	PASS();
+}
+
+TEST test_ring_two_thread_stress(void)
+{
+	char buffer[RING_SIZE];
+	digest_t direct = {0};
+	digest_t ringed = {0};
+	ihex_ring_t ring;
+	ihex_ctx_t ctx;
+	producer_t prod;
+	pthread_t tid;
+	int len = make_corpus();
+	int r;
+
+	ihex_init_sink(&ctx, digest_data, NULL, &direct);
+	ASSERT_EQ(len, ihex_parse_buffer(&ctx, corpus, len));
+	ASSERT(ctx.eof);
+
+	// a producer thread pushes byte by byte, as an ISR would, while this thread drains
+	ihex_ring_init(&ring, buffer, sizeof(buffer));
+	ihex_init_sink(&ctx, digest_data, NULL, &ringed);
+	prod.ring = &ring;
+	prod.src = corpus;
+	prod.len = len;
+	ASSERT_EQ(0, pthread_create(&tid, NULL, produce, &prod));
+	do
+	{
+		r = ihex_ring_drain(&ring, &ctx);
+		if(r == 0)
+			sched_yield();
+	} while(r >= 0 && !ctx.eof);
+	pthread_join(tid, NULL);
+
+	ASSERT_EQ(IHEX_OK, ctx.err);
+	ASSERT(ctx.eof);
+	ASSERT_EQ(0u, atomic_load(&ring.overruns));
+	ASSERT_EQ(direct.bytes, ringed.bytes);
+	ASSERT_EQ(direct.hash, ringed.hash);
+	PASS();
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+static int make_corpus(void)
+{
+	uint8_t data[STRESS_BYTES];
+	ihex_enc_t enc;
+	int len = 0;
+	int done = 0;
+	int i;
+
+	for(i=0; i < STRESS_BYTES; i++)
+		data[i] = (uint8_t)(i * 131 + (i >> 8));
+
+	ihex_enc_init(&enc, corpus, sizeof(corpus), 32);
+	enc.crlf = true;
+	while(done < STRESS_BYTES)
+		done += ihex_enc_write(&enc, 0x0800F000 + done, &data[done], STRESS_BYTES - done);
+	ihex_enc_eof(&enc);
+	len = enc.out_len;
+
+	return len;
+}
+
+static void* produce(void *arg)
+{
+	producer_t *prod = arg;
+	int i;
+
+	for(i=0; i < prod->len; i++)
+	{
+		// a real ISR would count an overrun, here the byte is held until there is room
+		while(ihex_ring_count(prod->ring) > prod->ring->mask)
+			sched_yield();
+		ihex_ring_push(prod->ring, prod->src[i]);
+	};
+
+	return NULL;
+}
+
+static int digest_data(void *user, uint32_t address, const uint8_t *data, int size)
+{
+	digest_t *d = user;
+	int i;
+
+	d->hash = d->hash * 31 + address;
+	for(i=0; i < size; i++)
+		d->hash = d->hash * 31 + data[i];
+	d->bytes += size;
+
+	return IHEX_OK;
+}
@@ -0,0 +1,343 @@
+
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <errno.h>
+	#include <strings.h>
+	#include <time.h>
+	#include <dirent.h>
+	#include <unistd.h>
+	#include <sys/stat.h>
+
+	#include "ihex.h"
+	#include "ihex_bin.h"
+
+//********************************************************************************************************
+// Local defines
+//********************************************************************************************************
+
+	#define PATH_MAX_LEN	4096
+
+//	Paths of one job, kept alongside the job
+	typedef struct paths_t
+	{
+		char *hex;
+		char *bin;
+		char *manifest;
+	} paths_t;
+
+//	One path a job reads or writes, sorted to find jobs that would write the same file
+	typedef struct path_use_t
+	{
+		const char *path;
+		int job;
+		bool output;
+	} path_use_t;
+
+//********************************************************************************************************
+// Private variables
+//********************************************************************************************************
+
+	static ihex_bin_job_t *jobs;
+	static paths_t *paths;
+	static int job_count;
+	static int job_max;
+
+//********************************************************************************************************
+// Private prototypes
+//********************************************************************************************************
+
+	static int add_input(const char *path, const char *out_dir);
+	static int add_job(const char *hex_path, const char *out_dir);
+	static char* out_path(const char *hex_path, const char *out_dir, const char *ext);
+	static int check_outputs(void);
+	static int compare_uses(const void *a, const void *b);
+	static bool is_hex_name(const char *name);
+	static bool parse_number(const char *s, long *value);
+	static void usage(void);
+
+//********************************************************************************************************
+// Public functions
+//********************************************************************************************************
+
+//	./hex2bin [-j threads] [-m buffered|mmap|sparse] [-f fill] [-o dir] [-q] file.hex|dir ...
+//	Converts every file given, and every .hex file in the directories given, to a .bin and a .manifest next to
+//	 it (or in dir). Directories are not searched recursively.
+int main(int argc, char **argv)
+{
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *out_dir = NULL;
+	int output = IHEX_BIN_BUFFERED;
+	long fill = -1;
+	bool quiet = false;
+	bool bad = false;
+	uint64_t bytes = 0;
+	int failed = 0;
+	int err = IHEX_OK;
+	struct timespec t0, t1;
+	double s;
+	int i;
+
+	for(i=1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if(strcmp(argv[i], "-j") == 0 && i+1 < argc)
+			bad |= !parse_number(argv[++i], &threads) || threads < 1;
+		else if(strcmp(argv[i], "-f") == 0 && i+1 < argc)
+			bad |= !parse_number(argv[++i], &fill);
+		else if(strcmp(argv[i], "-m") == 0 && i+1 < argc)
+		{
+			i++;
+			if(strcmp(argv[i], "mmap") == 0)
+				output = IHEX_BIN_MMAP;
+			else if(strcmp(argv[i], "sparse") == 0)
+				output = IHEX_BIN_SPARSE;
+			else if(strcmp(argv[i], "buffered") != 0)
+				output = -1;
+		}
+		else if(strcmp(argv[i], "-o") == 0 && i+1 < argc)
+			out_dir = argv[++i];
+		else if(strcmp(argv[i], "-q") == 0)
+			quiet = true;
+		else
+			break;
+	};
+
+	// gaps are holes unless a fill is asked for
+	if(fill < 0)
+		fill = (output == IHEX_BIN_BUFFERED) ? 0xFF : 0x00;
+
+	if(i >= argc || bad || fill > 0xFF || output < 0)
+	{
+		usage();
+		return 2;
+	};
+
+	for(; i < argc && err == IHEX_OK; i++)
+		err = add_input(argv[i], out_dir);
+	if(err == IHEX_OK)
+		err = check_outputs();
+	if(err != IHEX_OK)
+		return 2;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	ihex_bin_batch(jobs, job_count, (int)threads, (uint8_t)fill, output);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	for(i=0; i < job_count; i++)
+	{
+		if(jobs[i].err != IHEX_OK)
+		{
+			fprintf(stderr, "%s: %s\n", jobs[i].hex_path, ihex_strerr(jobs[i].err));
+			failed++;
+		}
+		else
+			bytes += jobs[i].size;
+	};
+
+	if(!quiet)
+		printf("%d files, %d failed, %.1f MB written in %.3f s\n", job_count, failed, bytes / 1e6, s);
+
+	return failed ? 1:0;
+}
+
+//********************************************************************************************************
+// Private functions
+//********************************************************************************************************
+
+//	A file is converted whatever its name, a directory contributes its .hex files
+static int add_input(const char *path, const char *out_dir)
+{
+	char hex_path[PATH_MAX_LEN];
+	struct stat st;
+	struct dirent *e;
+	DIR *dir;
+	int err = IHEX_OK;
+
+	if(stat(path, &st) != 0)
+	{
+		fprintf(stderr, "%s: not found\n", path);
+		err = IHEX_ERR_IO;
+	}
+	else if(!S_ISDIR(st.st_mode))
+		err = add_job(path, out_dir);
+	else if((dir = opendir(path)) == NULL)
+	{
+		fprintf(stderr, "%s: cannot be read\n", path);
+		err = IHEX_ERR_IO;
+	}
+	else
+	{
+		while(err == IHEX_OK && (e = readdir(dir)) != NULL)
+		{
+			if(is_hex_name(e->d_name) && snprintf(hex_path, sizeof(hex_path), "%s/%s", path, e->d_name) < (int)sizeof(hex_path))
+				err = add_job(hex_path, out_dir);
+		};
+		closedir(dir);
+	};
+
+	return err;
+}
+
+static int add_job(const char *hex_path, const char *out_dir)
+{
+	ihex_bin_job_t *j;
+	paths_t *p;
+	int max;
+	int err = IHEX_OK;
+
+	if(job_count == job_max)
+	{
+		max = job_max ? job_max*2 : 256;
+		j = realloc(jobs, max * sizeof(ihex_bin_job_t));
+		if(j)
+			jobs = j;
+		p = realloc(paths, max * sizeof(paths_t));
+		if(p)
+			paths = p;
+		if(j && p)
+			job_max = max;
+	};
+
+	if(job_count == job_max)
+		err = IHEX_ERR_FULL;
+	else
+	{
+		p = &paths[job_count];
+		p->hex = strdup(hex_path);
+		p->bin = out_path(hex_path, out_dir, ".bin");
+		p->manifest = out_path(hex_path, out_dir, ".manifest");
+		if(!p->hex || !p->bin || !p->manifest)
+			err = IHEX_ERR_FULL;
+	};
+
+	if(err == IHEX_OK)
+	{
+		memset(&jobs[job_count], 0, sizeof(ihex_bin_job_t));
+		jobs[job_count].hex_path = p->hex;
+		jobs[job_count].bin_path = p->bin;
+		jobs[job_count].manifest_path = p->manifest;
+		job_count++;
+	}
+	else
+		fprintf(stderr, "out of memory\n");
+
+	return err;
+}
+
+//	hex_path with its extension replaced by ext, in out_dir if given
+static char* out_path(const char *hex_path, const char *out_dir, const char *ext)
+{
+	const char *name = strrchr(hex_path, '/');
+	const char *dot;
+	char *path;
+	size_t stem, dir_len;
+
+	name = name ? name+1 : hex_path;
+	dot = strrchr(name, '.');
+	if(out_dir)
+	{
+		dir_len = strlen(out_dir);
+		stem = dot ? (size_t)(dot - name) : strlen(name);
+	}
+	else
+	{
+		dir_len = 0;
+		stem = dot ? (size_t)(dot - hex_path) : strlen(hex_path);
+		name = hex_path;
+	};
+
+	path = malloc(dir_len + 1 + stem + strlen(ext) + 1);
+	if(path)
+	{
+		if(out_dir)
+			sprintf(path, "%s/%.*s%s", out_dir, (int)stem, name, ext);
+		else
+			sprintf(path, "%.*s%s", (int)stem, name, ext);
+	};
+
+	return path;
+}
+
+//	Jobs run concurrently, so no two may write the same file (a.hex and a.ihex, or fw.hex from two directories
+//	 under -o), nor may one overwrite another's input. Paths are compared as spelt.
+static int check_outputs(void)
+{
+	path_use_t *uses = malloc(((size_t)job_count * 3 + 1) * sizeof(path_use_t));
+	int err = IHEX_OK;
+	int n = 0;
+	int i;
+
+	if(!uses)
+	{
+		fprintf(stderr, "out of memory\n");
+		err = IHEX_ERR_FULL;
+	}
+	else
+	{
+		for(i=0; i < job_count; i++)
+		{
+			uses[n++] = (path_use_t){jobs[i].hex_path, i, false};
+			uses[n++] = (path_use_t){jobs[i].bin_path, i, true};
+			uses[n++] = (path_use_t){jobs[i].manifest_path, i, true};
+		};
+		qsort(uses, n, sizeof(path_use_t), compare_uses);
+
+		// equal paths sort next to each other, two inputs alone are only the same file given twice
+		for(i=1; i < n; i++)
+		{
+			if(strcmp(uses[i-1].path, uses[i].path) == 0 && (uses[i-1].output || uses[i].output))
+			{
+				if(uses[i-1].output && uses[i].output)
+					fprintf(stderr, "%s and %s would both be converted to %s\n", jobs[uses[i-1].job].hex_path, jobs[uses[i].job].hex_path, uses[i].path);
+				else
+					fprintf(stderr, "%s would be overwritten converting %s\n", uses[i].path, jobs[uses[i-1].output ? uses[i-1].job : uses[i].job].hex_path);
+				err = IHEX_ERR_IO;
+			};
+		};
+		free(uses);
+	};
+
+	return err;
+}
+
+static int compare_uses(const void *a, const void *b)
+{
+	const path_use_t *x = a;
+	const path_use_t *y = b;
+
+	return strcmp(x->path, y->path);
+}
+
+static bool is_hex_name(const char *name)
+{
+	const char *dot = strrchr(name, '.');
+
+	return dot && dot != name && (strcasecmp(dot, ".hex") == 0 || strcasecmp(dot, ".ihex") == 0);
+}
+
+//	The whole of s as a number (decimal, or hex with 0x), which must not be negative
+static bool parse_number(const char *s, long *value)
+{
+	char *end;
+
+	errno = 0;
+	*value = strtol(s, &end, 0);
+
+	return end != s && *end == '\0' && errno == 0 && *value >= 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hex2bin [-j threads] [-m buffered|mmap|sparse] [-f fill] [-o dir] [-q] file.hex|dir ...\n"
+		"  -j  worker threads (default: one per CPU)\n"
+		"  -m  build each .bin in memory and write it out (default), copy records into the mapped .bin,\n"
+		"      or pwrite() runs of records to it. With mmap and sparse, gaps are left as holes if fill is 0\n"
+		"  -f  value of bytes not in any record (default 0xFF, or 0 with mmap and sparse)\n"
+		"  -o  write the .bin and .manifest files to dir instead of next to each input\n"
+		"  -q  no summary\n");
+}